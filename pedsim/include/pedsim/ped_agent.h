@@ -43,6 +43,21 @@ public:
         ELDER = 3
     };
 
+    /// How closely the agent is simulated, see Tscene::setLevelOfDetail()
+    enum DetailLevel {
+        FULL_DETAIL = 0, ///< all forces, every step
+        HALF_RATE = 1, ///< all forces, updated every second step
+        QUARTER_RATE = 2, ///< all forces, updated every fourth step
+        COARSE = 3 ///< desired and obstacle force and coarse separation, every fourth step
+    };
+
+    /// How move() integrates the forces, see setIntegrator()
+    enum Integrator {
+        EULER = 0, ///< velocity first, then the position with the new velocity
+        SEMI_IMPLICIT_EULER = 1, ///< as EULER, with the relaxation towards the desired velocity implicit
+        VELOCITY_VERLET = 2 ///< position with the acceleration, velocity with the mean acceleration
+    };
+
     Tagent();
     virtual ~Tagent();
 
@@ -59,6 +74,7 @@ public:
     virtual void setType(AgentType typeIn) { type = typeIn; };
     virtual void setVmax(double vmax);
     virtual void SetRadius(double radius) { agentRadius = radius; }
+    double getRadius() const { return agentRadius; }
 
     void setTeleop(bool opstatus) { teleop = opstatus; }
 
@@ -67,6 +83,8 @@ public:
     double getVmax() const { return vmax; };
     double getRelaxationTime() const { return relaxationTime; };
     bool getTeleop() { return teleop; }
+    DetailLevel getDetailLevel() const { return detailLevel; }
+    void setDetailLevel(DetailLevel level) { detailLevel = level; }
 
     // these getter should replace the ones later (returning the individual vector values)
     const Tvector& getPosition() const { return p; }
@@ -83,8 +101,19 @@ public:
     double getay() const { return a.y; };
     double getaz() const { return a.z; };
 
-    void setvx(double vv) { v.x = vv; }
-    void setvy(double vv) { v.y = vv; }
+    void setvx(double vv) { v.x = vv; sleeping = false; }
+    void setvy(double vv) { v.y = vv; sleeping = false; }
+
+    // → sleeping agents are neither moved nor their forces computed
+    bool isSleeping() const { return sleeping; }
+    void sleep();
+    void wakeUp();
+    int updateRestingSteps(double maxSpeed, double maxAcceleration);
+    bool hasNewTarget() const;
+
+    void setIntegrator(Integrator integratorIn, int maxSubstepsIn = 1);
+    Integrator getIntegrator() const { return integrator; }
+    int getMaxSubsteps() const { return maxSubsteps; }
 
     virtual void setForceFactorDesired(double f);
     virtual void setForceFactorSocial(double f);
@@ -103,6 +132,23 @@ protected:
     double agentRadius;
     double relaxationTime;
     bool teleop;
+    DetailLevel detailLevel;
+
+    bool sleeping;
+    int restingSteps; ///< consecutive steps with low speed and force
+    const Twaypoint* sleepingWaypoint; ///< destination when falling asleep
+    Tvector sleepingTarget;
+
+    Integrator integrator;
+    int maxSubsteps;
+    // state at the last force computation, the stiff forces are evaluated again from it
+    Tvector forcePosition;
+    Tvector desiredVelocity;
+
+    int getSubsteps(double stepSize) const;
+    double getRelaxationRate() const;
+    Tvector getOtherAcceleration(const Tvector& position) const;
+    void limitVelocity();
 
     double forceFactorDesired;
     double forceFactorSocial;
@@ -12,10 +12,13 @@
 #define LIBEXPORT
 #endif
 
+#include "ped_vector.h"
+
 #include <set>
 #include <vector>
 #include <map>
 #include <list>
+#include <unordered_map>
 
 using namespace std;
 
@@ -64,6 +67,11 @@ namespace Ped {
 		
 		virtual void cleanup();
 		virtual void moveAgents(double h);
+
+		void setLevelOfDetail(double fullRadius, double halfRadius, double quarterRadius, double hysteresis);
+		Tvector getCoarseSeparation(const Tagent* agent) const;
+		void setSleepDetection(int steps, double maxSpeed, double maxAcceleration, double radius);
+		void setIntegrator(int integratorIn, int maxSubstepsIn);
 		
 		set<const Ped::Tagent*> getNeighbors(double x, double y, double dist) const;
 		const vector<Tagent*>& getAllAgents() const { return agents; };
@@ -78,6 +86,39 @@ namespace Ped {
 		void placeAgent(const Ped::Tagent *a);
 		void moveAgent(const Ped::Tagent *a);
 		void getNeighbors(std::vector<const Ped::Tagent*>& neighborList, double x, double y, double dist) const;
+
+		void updateLevelsOfDetail();
+		int getDetailLevelAt(double distance) const;
+		bool isForceUpdateDue(const Tagent* agent) const;
+
+		// level of detail zones around the robots (disabled for lodFullRadius <= 0)
+		double lodFullRadius;
+		double lodHalfRadius;
+		double lodQuarterRadius;
+		double lodHysteresis;
+		unsigned long lodStep;
+
+		// agent count and position sum per cell, for the coarse separation
+		struct CoarseCell {
+			int count;
+			double x;
+			double y;
+		};
+		unordered_map<long long, CoarseCell> coarseCells;
+
+		void wakeAgents();
+		void putAgentsToSleep();
+
+		// agents resting for sleepSteps fall asleep (disabled for sleepSteps <= 0)
+		int sleepSteps;
+		double sleepMaxSpeed;
+		double sleepMaxAcceleration;
+		double wakeRadius;
+		vector<const Tagent*> wakeCandidates;
+
+		// integration of newly added agents (Tagent::Integrator)
+		int integrator;
+		int maxSubsteps;
 	};
 }
 #endif
@@ -30,6 +30,12 @@ Ped::Tagent::Tagent()
     type = ADULT;
     scene = nullptr;
     teleop = false;
+    detailLevel = FULL_DETAIL;
+    sleeping = false;
+    restingSteps = 0;
+    sleepingWaypoint = nullptr;
+    integrator = EULER;
+    maxSubsteps = 1;
 
     // assign random maximal speed in m/s
     normal_distribution<double> distribution(1.34, 0.26);
@@ -80,6 +86,63 @@ void Ped::Tagent::setPosition(double px, double py, double pz)
     p.x = px;
     p.y = py;
     p.z = pz;
+    sleeping = false;
+}
+
+/// Puts the agent to sleep, it stands still until woken up again. The
+/// current destination is remembered, see hasNewTarget().
+void Ped::Tagent::sleep()
+{
+    sleeping = true;
+    v = Tvector();
+    a = Tvector();
+
+    sleepingWaypoint = getCurrentWaypoint();
+    if (sleepingWaypoint != nullptr)
+        sleepingTarget = sleepingWaypoint->getPosition();
+}
+
+void Ped::Tagent::wakeUp()
+{
+    sleeping = false;
+    restingSteps = 0;
+}
+
+/// Counts the consecutive steps the agent hardly moved and was hardly
+/// pushed. Called after each move.
+/// \return  the number of steps the agent has been resting
+/// \param   maxSpeed speed up to which the agent is considered resting
+/// \param   maxAcceleration net force up to which the agent is considered resting
+int Ped::Tagent::updateRestingSteps(double maxSpeed, double maxAcceleration)
+{
+    if ((v.length() < maxSpeed) && (a.length() < maxAcceleration))
+        restingSteps++;
+    else
+        restingSteps = 0;
+    return restingSteps;
+}
+
+/// Whether the agent wants to go somewhere else than when it fell
+/// asleep, either a different waypoint or the waypoint moved.
+bool Ped::Tagent::hasNewTarget() const
+{
+    const Twaypoint* waypoint = getCurrentWaypoint();
+    if (waypoint != sleepingWaypoint)
+        return true;
+    return (waypoint != nullptr) && (waypoint->getPosition() != sleepingTarget);
+}
+
+/// Selects how the agent's forces are integrated in move(). With more than one
+/// substep, a step is split when the agent is pressed against an obstacle or the
+/// relaxation would overshoot. The stiff forces, the relaxation towards the desired
+/// velocity and the repulsion of the closest obstacle, are evaluated again for each
+/// substep, all other forces are held.
+/// \param   integratorIn the integration scheme
+/// \param   maxSubstepsIn the most substeps per step, 1 never splits a step
+void Ped::Tagent::setIntegrator(Integrator integratorIn, int maxSubstepsIn)
+{
+    integrator = integratorIn;
+    maxSubsteps = max(maxSubstepsIn, 1);
 }
 
 /// Sets the factor by which the desired force is multiplied. Values between 0
@@ -227,6 +290,19 @@ Ped::Tvector Ped::Tagent::myForce(Ped::Tvector e) const
 
 void Ped::Tagent::computeForces()
 {
+    // far away agents only keep off the walls and crowded cells
+    if (detailLevel == COARSE) {
+        neighbors.clear();
+        desiredforce = desiredForce();
+        socialforce = (forceFactorSocial > 0) ? scene->getCoarseSeparation(this) : Tvector();
+        if (forceFactorObstacle > 0)
+            obstacleforce = obstacleForce();
+        myforce = Tvector();
+        forcePosition = p;
+        desiredVelocity = v + relaxationTime * desiredforce;
+        return;
+    }
+
     // update neighbors
     // NOTE - have a config value for the neighbor range
     const double neighborhoodRange = 10.0;
@@ -239,6 +315,9 @@ void Ped::Tagent::computeForces()
     if (forceFactorObstacle > 0)
         obstacleforce = obstacleForce();
     myforce = myForce(desiredDirection);
+
+    forcePosition = p;
+    desiredVelocity = v + relaxationTime * desiredforce;
 }
 
 /// Does the agent dynamics stuff. Calls the methods to calculate the individual
@@ -248,24 +327,118 @@ void Ped::Tagent::computeForces()
 /// which is applied to the agents velocity, and then to its position.
 /// \param   stepSizeIn This tells the simulation how far the agent should
 /// proceed
+/// \see     Ped::Tagent::setIntegrator()
 void Ped::Tagent::move(double stepSizeIn)
 {
     // sum of all forces --> acceleration
     a = forceFactorDesired * desiredforce + forceFactorSocial * socialforce + forceFactorObstacle * obstacleforce + myforce;
 
-    // calculate the new velocity
-    if (getTeleop() == false) {
-        v = v + stepSizeIn * a;
+    // teleoperated agents keep the velocity they are given
+    if (getTeleop() == true) {
+        limitVelocity();
+        p += stepSizeIn * v;
+        scene->moveAgent(this);
+        return;
+    }
+
+    const int substeps = getSubsteps(stepSizeIn);
+    const double h = stepSizeIn / substeps;
+    const double rate = getRelaxationRate();
+    for (int i = 0; i < substeps; i++) {
+        switch (integrator) {
+        case SEMI_IMPLICIT_EULER: {
+            // v' = v + h * (other + rate * (desired - v'))
+            const Tvector other = getOtherAcceleration(p);
+            v = (v + h * (other + rate * desiredVelocity)) / (1 + h * rate);
+            limitVelocity();
+            p += h * v;
+            a = other + rate * (desiredVelocity - v);
+            break;
+        }
+        case VELOCITY_VERLET: {
+            // the velocity dependent forces use the velocity at the start of the substep
+            const Tvector before = getOtherAcceleration(p) + rate * (desiredVelocity - v);
+            Tvector displacement = h * v + (0.5 * h * h) * before;
+            if (displacement.length() > h * vmax)
+                displacement = displacement.normalized() * (h * vmax);
+            p += displacement;
+
+            a = getOtherAcceleration(p) + rate * (desiredVelocity - v);
+            v = v + (0.5 * h) * (before + a);
+            limitVelocity();
+            break;
+        }
+        default:
+            // the forces of the step, then the stiff ones again for each substep
+            if (i > 0)
+                a = getOtherAcceleration(p) + rate * (desiredVelocity - v);
+            v = v + h * a;
+            limitVelocity();
+            p += h * v;
+            break;
+        }
     }
 
-    // don't exceed maximal speed
+    // notice scene of movement
+    scene->moveAgent(this);
+}
+
+/// Don't exceed the maximal speed.
+void Ped::Tagent::limitVelocity()
+{
     double speed = v.length();
     if (speed > vmax)
         v = v.normalized() * vmax;
+}
 
-    // internal position update = actual move
-    p += stepSizeIn * v;
+/// Splits a step so that the stiff forces stay stable. The obstacle repulsion
+/// acts like a spring, the relaxation like a damper (unless it is integrated
+/// implicitly), and agents should not move further than half the range of the
+/// obstacle force in one substep.
+/// \return  the number of substeps, at most maxSubsteps
+/// \param   stepSize the step to split
+int Ped::Tagent::getSubsteps(double stepSize) const
+{
+    if (maxSubsteps <= 1)
+        return 1;
+
+    double maxStep = INFINITY;
+    const double stiffness = forceFactorObstacle * obstacleforce.length() / forceSigmaObstacle;
+    if (stiffness > 0)
+        maxStep = 1.0 / sqrt(stiffness);
+    const double rate = getRelaxationRate();
+    if ((integrator != SEMI_IMPLICIT_EULER) && (rate > 0))
+        maxStep = min(maxStep, 1.0 / rate);
+    const double speed = max(v.length(), vmax);
+    if (speed > 0)
+        maxStep = min(maxStep, 0.5 * forceSigmaObstacle / speed);
+
+    const double substeps = ceil(stepSize / maxStep);
+    return (substeps < maxSubsteps) ? max(static_cast<int>(substeps), 1) : maxSubsteps;
+}
 
-    // notice scene of movement
-    scene->moveAgent(this);
+/// Rate at which the velocity relaxes towards the desired velocity, 0 when the
+/// agent has no desired force.
+double Ped::Tagent::getRelaxationRate() const
+{
+    if (desiredforce == Tvector())
+        return 0;
+    return forceFactorDesired / relaxationTime;
+}
+
+/// All forces except the desired force, for the agent at another position. The
+/// closest obstacle is taken as a plane and its repulsion is scaled by the
+/// distance moved towards or away from it.
+/// \return  Tvector: the acceleration
+/// \param   position the position of the agent
+Ped::Tvector Ped::Tagent::getOtherAcceleration(const Tvector& position) const
+{
+    Tvector obstacle = obstacleforce;
+    const double strength = obstacleforce.length();
+    if (strength > 0) {
+        const double approach = Tvector::dotProduct(position - forcePosition, obstacleforce / strength);
+        obstacle *= exp(-approach / forceSigmaObstacle);
+    }
+
+    return forceFactorSocial * socialforce + forceFactorObstacle * obstacle + myforce;
 }
@@ -11,15 +11,32 @@
 
 #include <cstddef>
 #include <algorithm>
+#include <cmath>
 #include <stack>
 
 using namespace std;
 
+// side length of the cells used for the coarse separation
+static const double COARSE_CELL_SIZE = 2.0;
+// decay of the coarse separation force with the distance to a cell's agents
+static const double COARSE_SEPARATION_RANGE = 0.5;
+
+static long long coarseCellCoordinate(double x) {
+	return static_cast<long long>(floor(x / COARSE_CELL_SIZE));
+}
+
+// (shifts the unsigned bits, shifting negative cells is undefined)
+static long long coarseCellKey(long long cx, long long cy) {
+	return static_cast<long long>((static_cast<unsigned long long>(cx) << 32) ^ (static_cast<unsigned long long>(cy) & 0xffffffffULL));
+}
+
 
 /// Default constructor. If this constructor is used, there will be no quadtree created. 
 /// This is faster for small scenarios or less than 1000 Tagents.
 Ped::Tscene::Tscene() 
-	: tree(NULL) {
+	: tree(NULL), lodFullRadius(0), lodHalfRadius(0), lodQuarterRadius(0), lodHysteresis(0), lodStep(0),
+	  sleepSteps(0), sleepMaxSpeed(0), sleepMaxAcceleration(0), wakeRadius(0),
+	  integrator(Ped::Tagent::EULER), maxSubsteps(1) {
 }
 
 
@@ -32,7 +49,10 @@ Ped::Tscene::Tscene()
 /// \param top is the upper side of the boundary
 /// \param width is the total width of the boundary. Basically from left to right.
 /// \param height is the total height of the boundary. Basically from top to down.
-Ped::Tscene::Tscene(double left, double top, double width, double height) {
+Ped::Tscene::Tscene(double left, double top, double width, double height)
+	: lodFullRadius(0), lodHalfRadius(0), lodQuarterRadius(0), lodHysteresis(0), lodStep(0),
+	  sleepSteps(0), sleepMaxSpeed(0), sleepMaxAcceleration(0), wakeRadius(0),
+	  integrator(Ped::Tagent::EULER), maxSubsteps(1) {
 	tree = new Ped::Ttree(this, 0, left, top, width, height);
 }
 
@@ -70,6 +90,7 @@ void Ped::Tscene::addAgent(Ped::Tagent* a) {
 	// (take responsibility for object deletion)
 	agents.push_back(a);
 	a->assignScene(this);
+	a->setIntegrator(static_cast<Tagent::Integrator>(integrator), maxSubsteps);
 	if(tree != NULL)
 		tree->addAgent(a);
 }
@@ -141,20 +162,232 @@ bool Ped::Tscene::removeWaypoint(Ped::Twaypoint* w) {
 }
 
 /// This is a convenience method. It calls Ped::Tagent::move(double h) for all agents in the Tscene.
+/// With level of detail enabled, the forces of agents far from the robots are only computed every 
+/// few steps. They keep moving every step, with the forces of their last update.
 /// \param   h This tells the simulation how far the agents should proceed. 
 /// \see     Ped::Tagent::move(double h)
+/// \see     Ped::Tscene::setLevelOfDetail()
 void Ped::Tscene::moveAgents(double h) {
+	// pick the level of detail of each agent
+	if (lodFullRadius > 0)
+		updateLevelsOfDetail();
+	lodStep++;
+
 	// first update states
 	for(Tagent* agent : agents)
 		agent->updateState();
 
+	// wake up sleeping agents that are needed again
+	if (sleepSteps > 0)
+		wakeAgents();
+
 	// then update forces
-	for(Tagent* agent : agents)
-		agent->computeForces();
+	for(Tagent* agent : agents) {
+		if (!agent->isSleeping() && isForceUpdateDue(agent))
+			agent->computeForces();
+	}
 
 	// finally move agents according to their forces
+	for(Tagent* agent : agents) {
+		if (!agent->isSleeping())
+			agent->move(h);
+	}
+
+	// agents that came to rest fall asleep
+	if (sleepSteps > 0)
+		putAgentsToSleep();
+}
+
+/// Simulates agents far from the robots with less detail. Agents closer than fullRadius to a robot
+/// are simulated every step. Up to halfRadius and quarterRadius, their forces are updated every 
+/// second and every fourth step. Beyond, they only follow the desired and obstacle force and keep 
+/// away from crowded cells instead of computing the social force (see Tagent::DetailLevel).
+/// Agents are moved to a more detailed level as soon as they enter its zone, but only moved to a
+/// less detailed level once they are hysteresis beyond the zone. Without robots in the scene, all
+/// agents are simulated in full detail.
+/// \param   fullRadius radius of the full detail zone, 0 disables the level of detail
+/// \param   halfRadius radius of the half rate zone
+/// \param   quarterRadius radius of the quarter rate zone
+/// \param   hysteresis distance beyond a zone before an agent leaves it
+void Ped::Tscene::setLevelOfDetail(double fullRadius, double halfRadius, double quarterRadius, double hysteresis) {
+	lodFullRadius = fullRadius;
+	lodHalfRadius = max(halfRadius, fullRadius);
+	lodQuarterRadius = max(quarterRadius, lodHalfRadius);
+	lodHysteresis = max(hysteresis, 0.0);
+
+	if (lodFullRadius <= 0) {
+		for(Tagent* agent : agents)
+			agent->setDetailLevel(Tagent::FULL_DETAIL);
+		coarseCells.clear();
+	}
+}
+
+int Ped::Tscene::getDetailLevelAt(double distance) const {
+	if (distance < lodFullRadius)
+		return Tagent::FULL_DETAIL;
+	if (distance < lodHalfRadius)
+		return Tagent::HALF_RATE;
+	if (distance < lodQuarterRadius)
+		return Tagent::QUARTER_RATE;
+	return Tagent::COARSE;
+}
+
+/// Internally used to pick the level of detail from the distance to the closest robot.
+void Ped::Tscene::updateLevelsOfDetail() {
+	vector<const Tagent*> robots;
+	for(const Tagent* agent : agents) {
+		if (agent->getType() == Tagent::ROBOT)
+			robots.push_back(agent);
+	}
+
+	bool hasCoarse = false;
+	for(Tagent* agent : agents) {
+		if (robots.empty() || (agent->getType() == Tagent::ROBOT)) {
+			agent->setDetailLevel(Tagent::FULL_DETAIL);
+			continue;
+		}
+
+		double distance = INFINITY;
+		for(const Tagent* robot : robots)
+			distance = min(distance, (agent->getPosition() - robot->getPosition()).length());
+
+		// more detail right away, less detail only well outside the zone
+		const int current = agent->getDetailLevel();
+		const int promoted = getDetailLevelAt(distance);
+		const int demoted = getDetailLevelAt(distance - lodHysteresis);
+		if (promoted < current)
+			agent->setDetailLevel(static_cast<Tagent::DetailLevel>(promoted));
+		else if (demoted > current)
+			agent->setDetailLevel(static_cast<Tagent::DetailLevel>(demoted));
+
+		hasCoarse |= (agent->getDetailLevel() == Tagent::COARSE);
+	}
+
+	// count the agents per cell for the coarse separation
+	coarseCells.clear();
+	if (!hasCoarse)
+		return;
+	for(const Tagent* agent : agents) {
+		CoarseCell& cell = coarseCells[coarseCellKey(coarseCellCoordinate(agent->getx()), coarseCellCoordinate(agent->gety()))];
+		cell.count++;
+		cell.x += agent->getx();
+		cell.y += agent->gety();
+	}
+}
+
+/// Internally used to spread the updates of the agents at reduced rate over the steps.
+bool Ped::Tscene::isForceUpdateDue(const Tagent* agent) const {
+	static const unsigned int strides[] = { 1, 2, 4, 4 };
+	const unsigned int stride = strides[agent->getDetailLevel()];
+	return ((lodStep + static_cast<unsigned int>(agent->getId())) % stride) == 0;
+}
+
+/// Repulsion from the agents in the surrounding cells. Each cell acts like a single agent at the 
+/// center of its agents, weighted by their number. This is much cheaper than the social force but
+/// only keeps agents from clumping together.
+/// \return  Tvector: the separation force
+/// \param   agent the agent to compute the force for
+Ped::Tvector Ped::Tscene::getCoarseSeparation(const Tagent* agent) const {
+	Tvector force;
+	const Tvector& p = agent->getPosition();
+	const long long cx = coarseCellCoordinate(p.x);
+	const long long cy = coarseCellCoordinate(p.y);
+	for (long long dx = -1; dx <= 1; dx++) {
+		for (long long dy = -1; dy <= 1; dy++) {
+			unordered_map<long long, CoarseCell>::const_iterator found = coarseCells.find(coarseCellKey(cx + dx, cy + dy));
+			if (found == coarseCells.end())
+				continue;
+
+			// don't push the agent away from itself
+			int count = found->second.count;
+			Tvector center(found->second.x, found->second.y);
+			if ((dx == 0) && (dy == 0)) {
+				count--;
+				center -= Tvector(p.x, p.y);
+			}
+			if (count <= 0)
+				continue;
+			center /= count;
+
+			Tvector diff = Tvector(p.x, p.y) - center;
+			double distance = diff.length();
+			if (distance < 1e-6)
+				continue;
+			force += count * exp(-distance / COARSE_SEPARATION_RANGE) * (diff / distance);
+		}
+	}
+	return force;
+}
+
+/// Lets agents that stand still fall asleep. An agent whose speed and net force stay below the
+/// thresholds for the given number of steps is no longer moved and its forces are not computed.
+/// Others still see it as a neighbor standing there. It wakes up when a moving agent comes within
+/// wakeRadius, or when its destination changes. Robots never fall asleep.
+/// \param   steps steps the agent has to rest before falling asleep, 0 disables sleeping
+/// \param   maxSpeed speed up to which an agent is resting
+/// \param   maxAcceleration net force (acceleration) up to which an agent is resting
+/// \param   radius distance at which moving agents wake up sleeping ones
+void Ped::Tscene::setSleepDetection(int steps, double maxSpeed, double maxAcceleration, double radius) {
+	sleepSteps = steps;
+	sleepMaxSpeed = maxSpeed;
+	sleepMaxAcceleration = maxAcceleration;
+	wakeRadius = radius;
+
+	if (sleepSteps <= 0) {
+		for(Tagent* agent : agents)
+			agent->wakeUp();
+	}
+}
+
+/// Sets how all agents, including the ones added later, integrate their forces.
+/// \param   integratorIn the integration scheme (Tagent::Integrator)
+/// \param   maxSubstepsIn the most substeps per step
+/// \see     Ped::Tagent::setIntegrator()
+void Ped::Tscene::setIntegrator(int integratorIn, int maxSubstepsIn) {
+	integrator = integratorIn;
+	maxSubsteps = maxSubstepsIn;
 	for(Tagent* agent : agents)
-		agent->move(h);
+		agent->setIntegrator(static_cast<Tagent::Integrator>(integrator), maxSubsteps);
+}
+
+/// Internally used to wake up sleeping agents with a new destination or someone walking by.
+void Ped::Tscene::wakeAgents() {
+	for(Tagent* agent : agents) {
+		if (!agent->isSleeping())
+			continue;
+
+		// this also lets the agent's planner move on
+		if (agent->hasNewTarget()) {
+			agent->wakeUp();
+			continue;
+		}
+
+		wakeCandidates.clear();
+		if (tree != NULL)
+			getNeighbors(wakeCandidates, agent->getx(), agent->gety(), wakeRadius);
+		else
+			wakeCandidates.assign(agents.begin(), agents.end());
+
+		for(const Tagent* other : wakeCandidates) {
+			if ((other == agent) || other->isSleeping() || (other->getVelocity().length() < sleepMaxSpeed))
+				continue;
+			if ((other->getPosition() - agent->getPosition()).length() < wakeRadius) {
+				agent->wakeUp();
+				break;
+			}
+		}
+	}
+}
+
+/// Internally used to send the agents to sleep that rested long enough.
+void Ped::Tscene::putAgentsToSleep() {
+	for(Tagent* agent : agents) {
+		if (agent->isSleeping() || (agent->getType() == Tagent::ROBOT) || agent->getTeleop())
+			continue;
+
+		if (agent->updateRestingSteps(sleepMaxSpeed, sleepMaxAcceleration) >= sleepSteps)
+			agent->sleep();
+	}
 }
 
 /// Internally used to update the quadtree. 
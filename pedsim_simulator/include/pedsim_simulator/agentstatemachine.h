@@ -34,6 +34,8 @@
 
 #include <QObject>
 
+#include <pedsim_simulator/eventscheduler.h>
+
 // Forward Declarations
 class Agent;
 class AttractionArea;
@@ -80,6 +82,7 @@ protected:
 	void deactivateState(AgentState stateIn);
 	bool checkGroupForAttractions(AttractionArea** attractionOut = nullptr) const;
 	QString stateToName(AgentState stateIn) const;
+	void scheduleAttractionLoss();
 
 	// Attributes
 protected:
@@ -98,6 +101,7 @@ protected:
 	// → Attraction
 	AttractionArea* groupAttraction;
 	bool shallLoseAttraction;
+	EventScheduler::EventId attractionLossEvent;
 };
 
 #endif
@@ -0,0 +1,125 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef AGENTSTATESDECODER_H
+#define AGENTSTATESDECODER_H
+
+#include <pedsim_msgs/AgentStatesDelta.h>
+#include <pedsim_msgs/AgentStatesPacked.h>
+
+#include <map>
+
+/// -----------------------------------------------------------------
+/// \class AgentStatesDecoder
+/// \brief Client side of /pedsim/agent_states_delta
+/// \details Rebuilds the full agent states from keyframes and the
+/// deltas in between. Header only, so consumers just need to depend
+/// on pedsim_msgs and this include.
+/// -----------------------------------------------------------------
+class AgentStatesDecoder {
+public:
+    struct AgentEntry {
+        float x, y, vx, vy;
+        uint8_t type;
+        uint8_t state;
+    };
+
+    AgentStatesDecoder() { reset(); }
+
+    /// forget everything, wait for the next keyframe
+    void reset()
+    {
+        agents_.clear();
+        synchronized_ = false;
+        last_sequence_ = 0;
+    }
+
+    /// apply a message, returns true if the states are valid afterwards
+    bool update(const pedsim_msgs::AgentStatesDelta& msg)
+    {
+        if (msg.is_keyframe) {
+            agents_.clear();
+        }
+        else if (!synchronized_ || msg.sequence != last_sequence_ + 1) {
+            // lost a delta (or never saw a keyframe), wait for the next one
+            synchronized_ = false;
+            return false;
+        }
+
+        for (const uint32_t id : msg.removed_ids)
+            agents_.erase(id);
+
+        const pedsim_msgs::AgentStatesPacked& states = msg.states;
+        for (size_t i = 0; i < states.ids.size(); i++) {
+            AgentEntry& entry = agents_[states.ids[i]];
+            entry.x = states.x[i];
+            entry.y = states.y[i];
+            entry.vx = states.vx[i];
+            entry.vy = states.vy[i];
+            entry.type = states.type[i];
+            entry.state = states.state[i];
+        }
+
+        header_ = msg.header;
+        last_sequence_ = msg.sequence;
+        synchronized_ = true;
+        return true;
+    }
+
+    bool isSynchronized() const { return synchronized_; }
+
+    /// reconstructed agents by id
+    const std::map<uint32_t, AgentEntry>& getAgents() const { return agents_; }
+
+    /// reconstructed agents in the packed format (ordered by id)
+    pedsim_msgs::AgentStatesPacked getStates() const
+    {
+        pedsim_msgs::AgentStatesPacked states;
+        states.header = header_;
+        for (const auto& agent : agents_) {
+            states.ids.push_back(agent.first);
+            states.x.push_back(agent.second.x);
+            states.y.push_back(agent.second.y);
+            states.vx.push_back(agent.second.vx);
+            states.vy.push_back(agent.second.vy);
+            states.type.push_back(agent.second.type);
+            states.state.push_back(agent.second.state);
+        }
+        return states;
+    }
+
+private:
+    std::map<uint32_t, AgentEntry> agents_;
+    std_msgs::Header header_;
+    uint32_t last_sequence_;
+    bool synchronized_;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef CROWDGRID_H
+#define CROWDGRID_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class CrowdGrid
+/// \brief Raster of the agent density and mean velocity
+/// \details Every cell keeps the number of agents in it and the sum
+/// of their velocities. The grid is updated incrementally: an agent
+/// that moves is removed from its old cell and added to the new one,
+/// agents that did not show up in a tick are removed.
+/// -----------------------------------------------------------------
+class CrowdGrid {
+public:
+    CrowdGrid();
+    virtual ~CrowdGrid();
+
+    /// \brief set the extents, clears all agents
+    void resize(double origin_x, double origin_y, double width, double height, double resolution);
+
+    /// \brief start a tick, call update for all agents afterwards
+    void beginUpdate();
+    /// \brief add or move an agent (agents outside the grid are ignored)
+    void update(int id, double x, double y, double vx, double vy);
+    /// \brief remove the agents that were not updated since beginUpdate
+    void endUpdate();
+
+    /// \brief index of the cell containing the point, -1 if outside
+    int cellIndex(double x, double y) const;
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    double getResolution() const { return resolution_; }
+    double getOriginX() const { return origin_x_; }
+    double getOriginY() const { return origin_y_; }
+
+    /// agents per square meter
+    double getDensity(int cell) const { return count_[cell] / cell_area_; }
+    int getCount(int cell) const { return count_[cell]; }
+    /// mean velocity of the agents in the cell, zero if empty
+    double getMeanVx(int cell) const { return count_[cell] > 0 ? vx_sum_[cell] / count_[cell] : 0.0; }
+    double getMeanVy(int cell) const { return count_[cell] > 0 ? vy_sum_[cell] / count_[cell] : 0.0; }
+
+protected:
+    struct Entry {
+        int cell;
+        double vx, vy;
+        uint32_t tick;
+    };
+
+    void add(int cell, double vx, double vy);
+    void remove(int cell, double vx, double vy);
+
+    double origin_x_, origin_y_;
+    double resolution_;
+    double cell_area_;
+    int width_, height_;
+
+    std::vector<int> count_;
+    std::vector<double> vx_sum_;
+    std::vector<double> vy_sum_;
+
+    // contribution of each agent, to undo it when the agent moves
+    std::unordered_map<int, Entry> entries_;
+    uint32_t tick_;
+};
+
+#endif
@@ -35,12 +35,12 @@
 #include <QGraphicsEllipseItem>
 #include <QGraphicsItemGroup>
 #include <QGraphicsLineItem>
-#include <QTimer>
 #include <pedsim/ped_vector.h>
 #include <pedsim_simulator/element/scenarioelement.h>
 
 // Forward Declarations
 class Agent;
+class Scene;
 
 class AgentGroup : public ScenarioElement {
     Q_OBJECT
@@ -58,10 +58,6 @@ signals:
     void memberAdded(int id);
     void memberRemoved(int id);
 
-    // Slots
-public slots:
-    void onPositionChanged(double x, double y);
-
     // Static Methods
 public:
     static QList<AgentGroup*> divideAgents(const QList<Agent*>& agentsIn);
@@ -84,19 +80,16 @@ public:
 public:
     // 	QPointF getCenterOfMass() const;
     Ped::Tvector getCenterOfMass() const;
-protected slots:
-    Ped::Tvector updateCenterOfMass();
+protected:
+    Ped::Tvector computeCenterOfMass() const;
 
     // → Recollection
 public:
     void setRecollect(bool recollectIn);
     bool isRecollecting() const;
-    double getMaxDistance();
+    double getMaxDistance() const;
     int getId() { return id_; }
 
-protected:
-    void updateMaxDistance();
-
     // → ScenarioElement Overrides
 public:
     virtual QString toString() const;
@@ -105,16 +98,13 @@ public:
 protected:
     QList<Agent*> members;
 
-    // → Center of Mass
-    bool dirty;
-    Ped::Tvector cacheCoM;
-    //   → delayed update
-    QTimer comUpdateTimer;
+    // → slot in the scene's per tick group aggregates (-1: not up to date,
+    //   e.g. after the members changed, computed on demand then)
+    friend class Scene;
+    int aggregateIndex;
 
     // → recollecting group
     bool recollecting;
-    bool dirtyMaxDistance;
-    double cacheMaxDistance;
 
     int id_;
 };
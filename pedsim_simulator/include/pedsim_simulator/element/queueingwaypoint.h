@@ -55,6 +55,9 @@ public:
 
     bool isWithinArea ( const Ped::Tvector& posIn );
 
+    // → route towards the queue while it's out of sight
+    void setRoutingWaypoint ( const Waypoint* waypointIn );
+
     virtual Ped::Tvector getForce ( const Ped::Tagent& agentIn, 
 									Ped::Tvector* desiredDirectionOut = NULL, 
 									bool* reached = NULL ) const;
@@ -66,6 +69,9 @@ public:
     virtual void setVisiblePosition ( const QPointF& positionIn );
     QString toString() const;
 
+    // Attributes
+protected:
+    const Waypoint* routingWaypoint;
 };
 
 #endif
@@ -34,13 +34,18 @@
 
 
 #include <pedsim_simulator/element/waypoint.h>
+#include <pedsim_simulator/eventscheduler.h>
 #include <pedsim/ped_vector.h>
 #include <QPointF>
+#include <QPointer>
 #include <ros/ros.h>
 
+#include <vector>
+
 
 // Forward Declarations
 class Agent;
+class QueueingWaypointPlanner;
 
 
 class WaitingQueue : public Waypoint
@@ -58,19 +63,12 @@ public:
 signals:
     void directionChanged ( double radianAngle );
     // → Waiting Agents
-    void agentMayPass ( int id );
     void agentDequeued ( int id );
     void queueLeaderChanged ( int id );
     void queueEndChanged();
     void queueEndPositionChanged ( double x, double y );
 
 
-    // Slots
-protected slots:
-    void onTimeChanged ( double timeIn );
-    void onLastAgentPositionChanged ( double xIn, double yIn );
-
-
     // Methods
 public:
     Ped::Tangle getDirection() const;
@@ -81,12 +79,20 @@ public:
     // → Queueing behavior
     bool isEmpty() const;
     Ped::Tvector getQueueEndPosition() const;
-    const Agent* enqueueAgent ( Agent* agentIn );
+    Ped::Tvector enqueueAgent ( Agent* agentIn, QueueingWaypointPlanner* plannerIn );
     bool dequeueAgent ( Agent* agentIn );
     bool hasReachedWaitingPosition();
+    void drawPrivateSpace ( double& distanceOut, Ped::Tangle& headingOut ) const;
+    // → agents walking towards the queue end
+    void addApproachingPlanner ( QueueingWaypointPlanner* plannerIn );
+    void removeApproachingPlanner ( QueueingWaypointPlanner* plannerIn );
+
+    // → update the queueing positions of all agents, once per tick
+    void updateQueue();
 protected:
     void resetDequeueTime();
     void startDequeueTime();
+    void onDequeueTime();
 
 protected:
     void informAboutEndPosition();
@@ -106,11 +112,25 @@ public:
 protected:
     Ped::Tangle direction;
 
-    QList<Agent*> queuedAgents;
+    // → agents in line, the first one is served next
+    struct QueueSlot {
+        Agent* agent;
+        QPointer<QueueingWaypointPlanner> planner;
+        // → private space towards the agent ahead
+        double spacing;
+        Ped::Tangle heading;
+        // → agent ahead at the last update
+        const Agent* ahead;
+    };
+    std::vector<QueueSlot> queueSlots;
+    std::vector<QPointer<QueueingWaypointPlanner> > approachingPlanners;
+    Ped::Tvector lastEndPosition;
+    bool endPositionChanged;
 
     // → dequeueing
     double waitDurationLambda;
     double dequeueTime;
+    EventScheduler::EventId dequeueEvent;
 };
 
 #endif
@@ -58,6 +58,9 @@ public:
     virtual void setPosition ( const Ped::Tvector& posIn );
     virtual void setx ( double xIn );
     virtual void sety ( double yIn );
+    virtual Ped::Tvector getForce ( const Ped::Tagent& agent,
+                                    Ped::Tvector* desiredDirectionOut = NULL,
+                                    bool* reachedOut = NULL ) const;
 
 
     // Attributes
@@ -0,0 +1,85 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef EVENTSCHEDULER_H
+#define EVENTSCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class EventScheduler
+/// \brief Callbacks that run once the simulated time reaches them
+/// \details Events are kept in a binary heap ordered by their time
+/// (and by insertion for equal times). Cancelled events stay in the
+/// heap and are skipped when they come up.
+/// -----------------------------------------------------------------
+class EventScheduler {
+public:
+    /// 0 is never handed out, it can be used as 'no event'
+    typedef uint64_t EventId;
+
+    EventScheduler();
+    virtual ~EventScheduler();
+
+    /// \brief run the callback at the first tick with time >= timeIn
+    EventId schedule(double timeIn, std::function<void()> callback);
+    /// \brief drop a pending event, unknown ids are ignored
+    void cancel(EventId id);
+    bool isPending(EventId id) const;
+
+    /// \brief run all events due at timeIn, in time order
+    void runUntil(double timeIn);
+    /// \brief drop all events
+    void clear();
+
+    size_t size() const { return callbacks_.size(); }
+
+protected:
+    struct Entry {
+        double time;
+        EventId id;
+
+        bool operator>(const Entry& other) const
+        {
+            return (time != other.time) ? (time > other.time) : (id > other.id);
+        }
+    };
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue_;
+    std::unordered_map<EventId, std::function<void()> > callbacks_;
+    EventId next_id_;
+};
+
+#endif
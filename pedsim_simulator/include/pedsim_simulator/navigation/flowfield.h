@@ -0,0 +1,71 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <pedsim_simulator/navigation/obstaclemap.h>
+
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class FlowField
+/// \brief Walking directions towards one goal for the whole map
+/// \details The path length to the goal is computed for every free
+/// cell by fast marching. Each cell then points downhill along the
+/// path lengths. Blocked cells next to free ones point back into the
+/// free space, for agents pushed close to a wall.
+/// -----------------------------------------------------------------
+class FlowField {
+public:
+    FlowField();
+    virtual ~FlowField();
+
+    /// \brief compute the field, the cells within the radius of the
+    /// goal are where the paths end
+    void compute(const ObstacleMap& map, double goal_x, double goal_y, double goal_radius);
+
+    /// \brief bilinear interpolation of the direction and the path
+    /// length between the centers of the four closest cells (the
+    /// direction of the closest one where the paths split up)
+    /// \return false outside of the map or where the goal is unreachable
+    bool lookup(const ObstacleMap& map, double x, double y,
+        double& dx, double& dy, double& distance) const;
+
+    /// path length from the cell, infinity if unreachable
+    float getDistance(int cell) const { return distance_[cell]; }
+
+protected:
+    std::vector<float> distance_;
+    // → unit direction per cell (x, y interleaved)
+    std::vector<float> direction_;
+};
+
+#endif
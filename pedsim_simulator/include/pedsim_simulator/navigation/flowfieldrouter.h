@@ -0,0 +1,65 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef FLOWFIELDROUTER_H
+#define FLOWFIELDROUTER_H
+
+#include <pedsim_simulator/navigation/flowfield.h>
+#include <pedsim_simulator/navigation/obstaclemap.h>
+#include <pedsim_simulator/navigation/router.h>
+
+#include <unordered_map>
+
+/// -----------------------------------------------------------------
+/// \class FlowFieldRouter
+/// \brief Router with one flow field per goal
+/// \details All fields share one obstacle raster and are computed
+/// when the router is built, a query is a bilinear lookup. In the open
+/// the straight line is kept: the field is only followed where the
+/// path to the goal is notably longer than the straight line.
+/// -----------------------------------------------------------------
+class FlowFieldRouter : public Router {
+public:
+    FlowFieldRouter(double resolution, double clearance);
+    virtual ~FlowFieldRouter();
+
+    virtual void build(const std::vector<Segment>& walls, const std::vector<Goal>& goals);
+    virtual bool getDirection(int agent, int goal, double x, double y, double target_x, double target_y,
+        double& dx, double& dy);
+
+protected:
+    double resolution_;
+    double clearance_;
+
+    ObstacleMap map_;
+    std::unordered_map<int, FlowField> fields_;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef OBSTACLEMAP_H
+#define OBSTACLEMAP_H
+
+#include <pedsim_simulator/navigation/router.h>
+
+#include <cstdint>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class ObstacleMap
+/// \brief Raster of the free space between the walls
+/// \details A cell is blocked when its center is closer than the
+/// clearance to a wall, so paths over free cells keep agents off the
+/// walls.
+/// -----------------------------------------------------------------
+class ObstacleMap {
+public:
+    ObstacleMap();
+    virtual ~ObstacleMap();
+
+    /// \brief rasterize the walls within the given extents
+    void build(const std::vector<Router::Segment>& walls, double min_x, double min_y,
+        double max_x, double max_y, double resolution, double clearance);
+
+    /// \brief index of the cell containing the point, -1 if outside
+    int cellIndex(double x, double y) const;
+
+    bool isBlocked(int cell) const { return blocked_[cell] != 0; }
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    int getNumCells() const { return width_ * height_; }
+    double getResolution() const { return resolution_; }
+    double getOriginX() const { return origin_x_; }
+    double getOriginY() const { return origin_y_; }
+
+    /// centers of the cells
+    double cellX(int ix) const { return origin_x_ + (ix + 0.5) * resolution_; }
+    double cellY(int iy) const { return origin_y_ + (iy + 0.5) * resolution_; }
+
+protected:
+    double origin_x_, origin_y_;
+    double resolution_;
+    int width_, height_;
+
+    std::vector<uint8_t> blocked_;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class Router
+/// \brief Global routing towards the waypoints of a scenario
+/// \details A router is built once for the walls and the goals and
+/// then answers in which direction an agent should walk to get to a
+/// goal around the walls. When the straight line to the target is
+/// good enough the router leaves the direction to the waypoint.
+/// -----------------------------------------------------------------
+class Router {
+public:
+    struct Segment {
+        double ax, ay, bx, by;
+    };
+    struct Goal {
+        int id;
+        double x, y, radius;
+    };
+
+    virtual ~Router() {}
+
+    /// \brief (re)build for the walls and the goals
+    virtual void build(const std::vector<Segment>& walls, const std::vector<Goal>& goals) = 0;
+
+    /// \brief unit walking direction of an agent at (x, y) towards the goal
+    /// \return false when heading straight for the target (the point
+    /// of the goal the agent aims at) is fine, or the goal is unknown
+    virtual bool getDirection(int agent, int goal, double x, double y, double target_x, double target_y,
+        double& dx, double& dy) = 0;
+
+    /// \brief drop what is kept about an agent that left the scene
+    virtual void forgetAgent(int agent) {}
+};
+
+#endif
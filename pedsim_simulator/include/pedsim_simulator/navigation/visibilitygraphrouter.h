@@ -0,0 +1,125 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef VISIBILITYGRAPHROUTER_H
+#define VISIBILITYGRAPHROUTER_H
+
+#include <pedsim_simulator/navigation/router.h>
+#include <pedsim_simulator/sensor/uniformgrid.h>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class VisibilityGraphRouter
+/// \brief Router over the corners of the walls
+/// \details The nodes are placed around the convex wall corners and
+/// free wall ends (at a clearance), edges connect the nodes that see
+/// each other. For every goal the shortest path tree towards it is
+/// computed on demand, the most recently used ones are kept.
+///
+/// An agent walks to the next corner of its path. When it gets there,
+/// the path is pulled tight: the agent heads for the farthest corner
+/// (or the goal) along the path it can see. A new route is only
+/// planned when the agent leaves the corridor around its current leg,
+/// or heads for a different goal.
+/// -----------------------------------------------------------------
+class VisibilityGraphRouter : public Router {
+public:
+    VisibilityGraphRouter(double clearance, double corridor_width, size_t cache_size);
+    virtual ~VisibilityGraphRouter();
+
+    virtual void build(const std::vector<Segment>& walls, const std::vector<Goal>& goals);
+    virtual bool getDirection(int agent, int goal, double x, double y, double target_x, double target_y,
+        double& dx, double& dy);
+    virtual void forgetAgent(int agent);
+
+    /// \brief whether the straight line keeps off the walls
+    bool isVisible(double ax, double ay, double bx, double by);
+
+    size_t getNumNodes() const { return nodes_.size(); }
+
+protected:
+    struct Node {
+        double x, y;
+        // → visible nodes and the distances to them
+        std::vector<int> neighbors;
+        std::vector<float> costs;
+    };
+
+    /// shortest paths from all nodes to a goal
+    struct PathTable {
+        std::vector<float> distance;
+        // → next node on the path, GOAL when the goal is in sight
+        std::vector<int> next;
+    };
+
+    /// leg of an agent's route, from where it was planned to a corner
+    struct Route {
+        int goal;
+        int node; // GOAL when walking straight to the target
+        double from_x, from_y;
+        double to_x, to_y;
+    };
+
+    enum {
+        GOAL = -1,
+        UNREACHABLE = -2
+    };
+
+    void addCornerNodes(double x, double y, std::vector<double>& angles);
+    bool isFree(double x, double y);
+    const PathTable* getPathTable(int goal);
+    bool plan(Route& route, int goal, double x, double y, double target_x, double target_y);
+    void pullString(Route& route, const PathTable& table, double x, double y, double target_x, double target_y,
+        bool at_corner);
+
+    double clearance_;
+    double corridor_width_;
+    size_t cache_size_;
+
+    std::vector<Segment> walls_;
+    UniformGrid wall_grid_;
+    // → walls already tested in a visibility query
+    std::vector<unsigned int> wall_stamps_;
+    unsigned int stamp_;
+
+    std::vector<Node> nodes_;
+    std::unordered_map<int, Goal> goals_;
+
+    // → least recently used path tables are dropped first
+    std::list<int> table_order_;
+    std::unordered_map<int, std::pair<PathTable, std::list<int>::iterator> > tables_;
+
+    std::unordered_map<int, Route> routes_;
+};
+
+#endif
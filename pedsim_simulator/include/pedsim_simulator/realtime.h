@@ -0,0 +1,87 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \brief Helpers for running the simulation loop in real time
+/// \details Scheduling and memory settings for the calling thread,
+/// they need the corresponding privileges (e.g. CAP_SYS_NICE,
+/// memlock limits) and return false with a reason otherwise.
+/// -----------------------------------------------------------------
+namespace realtime {
+
+/// \brief run the calling thread with SCHED_FIFO at the given priority
+bool setFifoPriority(int priority, std::string& error);
+
+/// \brief restrict the calling thread to the given CPUs
+bool setCpuAffinity(const std::vector<int>& cpus, std::string& error);
+
+/// \brief lock current and future pages of the process in memory
+bool lockMemory(std::string& error);
+
+/// -----------------------------------------------------------------
+/// \class TickStatistics
+/// \brief Durations of the loop iterations and their overruns
+/// -----------------------------------------------------------------
+class TickStatistics {
+public:
+    TickStatistics();
+
+    void reset();
+    /// \brief record one tick, lateness is how far it ended after its deadline
+    void addTick(double duration, double lateness);
+
+    uint64_t getTicks() const { return ticks_; }
+    uint64_t getOverruns() const { return overruns_; }
+    double getMeanDuration() const { return ticks_ > 0 ? duration_sum_ / ticks_ : 0.0; }
+    double getMaxDuration() const { return max_duration_; }
+    double getLastDuration() const { return last_duration_; }
+    double getMaxLateness() const { return max_lateness_; }
+
+    std::string toString() const;
+
+protected:
+    uint64_t ticks_;
+    uint64_t overruns_;
+    double duration_sum_;
+    double max_duration_;
+    double last_duration_;
+    double max_lateness_;
+};
+
+} // namespace realtime
+
+#endif
@@ -0,0 +1,79 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef ROBOTKINEMATICS_H
+#define ROBOTKINEMATICS_H
+
+/// -----------------------------------------------------------------
+/// \class RobotKinematics
+/// \brief Planar robot driven by velocity commands
+/// \details Integrates commanded velocities (in the robot frame) into
+/// a pose, either as a differential drive robot (forward speed and
+/// turn rate only) or as a holonomic one (also sideways).
+/// -----------------------------------------------------------------
+class RobotKinematics {
+public:
+    enum Model { DIFF_DRIVE, HOLONOMIC };
+
+    RobotKinematics(Model model = DIFF_DRIVE, double x = 0, double y = 0, double theta = 0);
+    virtual ~RobotKinematics();
+
+    /// \brief set the commanded velocities in the robot frame
+    void setCommand(double vx, double vy, double omega);
+    /// \brief limit the linear speed (not limited if not positive)
+    void setMaxSpeed(double max_speed);
+
+    /// \brief advance the pose by dt seconds
+    void integrate(double dt);
+
+    void setPose(double x, double y, double theta);
+
+    Model getModel() const { return model_; }
+    double getX() const { return x_; }
+    double getY() const { return y_; }
+    double getTheta() const { return theta_; }
+
+    /// velocity of the last step in the world frame
+    double getWorldVx() const { return world_vx_; }
+    double getWorldVy() const { return world_vy_; }
+    /// commanded velocities as applied (after the model and limits)
+    double getVx() const { return vx_; }
+    double getVy() const { return vy_; }
+    double getOmega() const { return omega_; }
+
+protected:
+    Model model_;
+    double x_, y_, theta_;
+    double vx_, vy_, omega_;
+    double world_vx_, world_vy_;
+    double max_speed_;
+};
+
+#endif
@@ -34,11 +34,17 @@
 
 #include <pedsim/ped_scene.h>
 #include <pedsim/ped_vector.h>
+#include <QHash>
 #include <QMap>
 #include <QRectF>
 #include <QObject>
 
 #include <pedsim_simulator/utilities.h>
+#include <pedsim_simulator/eventscheduler.h>
+#include <pedsim_simulator/sensor/uniformgrid.h>
+
+#include <unordered_set>
+#include <vector>
 
 // Forward Declarations
 class QGraphicsScene;
@@ -49,6 +55,7 @@ class AttractionArea;
 class AgentCluster;
 class AgentGroup;
 class WaitingQueue;
+class Router;
 
 class Scene : public QObject, protected Ped::Tscene {
     Q_OBJECT
@@ -91,6 +98,7 @@ public slots:
     void moveAllAgents();
 protected slots:
     void cleanupScene();
+    void invalidateAttractionIndex();
 
     // Methods
 public:
@@ -113,11 +121,16 @@ public:
     const QList<AgentCluster*>& getAgentClusters() const;
     AttractionArea* getAttractionByName(const QString& nameIn) const;
     AttractionArea* getClosestAttraction(const Ped::Tvector& positionIn, double* distanceOut = nullptr) const;
+    AttractionArea* getClosestAttractionWithin(const Ped::Tvector& positionIn, double maxDistance, double* distanceOut = nullptr);
 
     // → simulation time
     double getTime() const;
     bool hasStarted() const;
 
+    // → time triggered events, run right after the scene time advanced
+    EventScheduler::EventId scheduleEvent(double timeIn, std::function<void()> callback);
+    void cancelEvent(EventScheduler::EventId id);
+
 protected:
     void dissolveClusters();
 
@@ -137,20 +150,67 @@ public:
 
     virtual std::set<const Ped::Tagent*> getNeighbors(double x, double y, double maxDist);
 
-    // obstacle cell locations
+    // → global routing towards the waypoints around the obstacles (optional)
+    void setRouter(Router* routerIn);
+    void buildRouter();
+    bool getRoutedDirection(int agentId, const Waypoint* waypoint, const Ped::Tvector& position,
+        const Ped::Tvector& target, Ped::Tvector* directionOut);
+
+    // → external changes of the agent state (keeps the spatial index up to date)
+    void relocateAgent(Agent* agent, const Ped::Tvector& position, const Ped::Tvector& velocity);
+
+    // → group aggregates, computed for all groups in one pass per tick
+    struct GroupAggregate {
+        Ped::Tvector centerOfMass;
+        double maxDistance;
+        int firstMember; // into the group member arrays
+        int memberCount;
+    };
+    void updateGroupAggregates();
+    const GroupAggregate* getGroupAggregate(const AgentGroup* group);
+    const std::vector<const Agent*>& getGroupMembers() const { return groupMembers; }
+    const std::vector<Ped::Tvector>& getGroupMemberPositions() const { return groupMemberPositions; }
+
+    // obstacle cell locations (unique)
     std::vector<Location> obstacle_cells_;
+    // → incremented whenever the obstacle cells change
+    int obstacle_cells_revision_;
+
+protected:
+    // → grid of the attractions whose influence radius reaches into each cell
+    void buildAttractionIndex(double radius);
+    UniformGrid attractionGrid;
+    std::vector<AttractionArea*> attractionItems;
+    double attractionIndexRadius;
+    bool attractionIndexValid;
+
+    Router* router;
+    int routerRevision;
+
+    void addObstacleCell(int x, int y);
+    // → occupied cells, used to skip duplicates (e.g. at shared wall endpoints)
+    std::unordered_set<uint64_t> obstacle_cell_keys_;
 
     // Attributes
 protected:
     QList<Agent*> agents;
+    QHash<int, Agent*> agentsById;
     QList<Obstacle*> obstacles;
     QMap<QString, Waypoint*> waypoints;
     QMap<QString, AttractionArea*> attractions;
     QList<AgentCluster*> agentClusters;
     QList<AgentGroup*> agentGroups;
+    QList<WaitingQueue*> waitingQueues;
+
+    // → flat arrays of the group aggregates, members of a group are contiguous
+    std::vector<GroupAggregate> groupAggregates;
+    std::vector<const Agent*> groupMembers;
+    std::vector<Ped::Tvector> groupMemberPositions;
+    bool groupAggregatesValid;
 
     // → simulated time
     double sceneTime;
+    EventScheduler events;
 };
 
 #endif
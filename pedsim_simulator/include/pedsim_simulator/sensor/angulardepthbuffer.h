@@ -0,0 +1,71 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef ANGULARDEPTHBUFFER_H
+#define ANGULARDEPTHBUFFER_H
+
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class AngularDepthBuffer
+/// \brief Line of sight test around a viewpoint
+/// \details The full circle around the viewpoint is split into bins,
+/// each holding the distance of the closest occluder seen so far. Walls
+/// are drawn first, then the agents are tested and drawn in order of
+/// increasing distance, so each test only has to look at the bins
+/// covered by the agent.
+/// -----------------------------------------------------------------
+class AngularDepthBuffer {
+public:
+    explicit AngularDepthBuffer(int num_bins = 1440);
+    virtual ~AngularDepthBuffer();
+
+    /// clear the buffer and move the viewpoint
+    void reset(double x, double y);
+
+    /// draw a wall (line segment)
+    void addWall(double ax, double ay, double bx, double by);
+
+    /// \brief check whether any part of the circle is visible, then draw it
+    /// \note circles have to be passed with increasing distance
+    bool testAndInsert(double x, double y, double radius);
+
+protected:
+    int angleToBin(double angle) const;
+
+private:
+    int num_bins_;
+    double bin_width_;
+    double x_;
+    double y_;
+    std::vector<double> depth_;
+};
+
+#endif
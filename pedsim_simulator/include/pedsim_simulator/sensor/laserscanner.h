@@ -0,0 +1,119 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef LASERSCANNER_H
+#define LASERSCANNER_H
+
+#include <pedsim_simulator/sensor/uniformgrid.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class LaserScanner
+/// \brief Simulated 2D laser range finder
+/// \details Casts beams against the walls (line segments) and the
+/// agents (circles). Both are kept in uniform grids, the walls one is
+/// only rebuilt when the walls change, the agents one for every scan
+/// from the agents close to the sensor. Beams are split into chunks
+/// processed by worker threads that live as long as the scanner, so
+/// a scan does not pay for creating threads. Small scans stay on the
+/// calling thread.
+/// -----------------------------------------------------------------
+class LaserScanner {
+public:
+    struct Segment {
+        double ax, ay, bx, by;
+    };
+    struct Circle {
+        double x, y, radius;
+    };
+
+    LaserScanner(double angle_min, double angle_max, double angle_increment,
+        double range_max, int num_threads);
+    virtual ~LaserScanner();
+
+    LaserScanner(const LaserScanner&) = delete;
+    LaserScanner& operator=(const LaserScanner&) = delete;
+
+    /// replace the static obstacles
+    void setWalls(const std::vector<Segment>& walls);
+
+    /// \brief measure from the sensor pose, ranges beyond range_max are
+    /// reported as infinity
+    void scan(double x, double y, double yaw, const std::vector<Circle>& agents,
+        std::vector<float>& ranges);
+
+    double getAngleMin() const { return angle_min_; }
+    double getAngleMax() const { return angle_max_; }
+    double getAngleIncrement() const { return angle_increment_; }
+    double getRangeMax() const { return range_max_; }
+    int getNumBeams() const { return num_beams_; }
+
+protected:
+    void castBeams(int first, int last, double x, double y, double yaw,
+        const std::vector<Circle>& agents, std::vector<float>& ranges) const;
+    double castWalls(double x, double y, double dx, double dy) const;
+    double castAgents(double x, double y, double dx, double dy,
+        const std::vector<Circle>& agents) const;
+    void runWorker(int index);
+
+private:
+    double angle_min_;
+    double angle_max_;
+    double angle_increment_;
+    double range_max_;
+    int num_beams_;
+    int num_threads_;
+
+    std::vector<Segment> walls_;
+    UniformGrid wall_grid_;
+    UniformGrid agent_grid_;
+
+    // worker pool, the scan in progress is handed over in job_
+    struct Job {
+        double x, y, yaw;
+        const std::vector<Circle>* agents;
+        std::vector<float>* ranges;
+        int chunk;
+    };
+    std::vector<std::thread> workers_;
+    std::mutex pool_mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    Job job_;
+    unsigned int generation_; // incremented for every job
+    int pending_; // workers still busy with the job
+    bool stopping_;
+};
+
+#endif
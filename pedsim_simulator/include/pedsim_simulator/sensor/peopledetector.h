@@ -0,0 +1,80 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef PEOPLEDETECTOR_H
+#define PEOPLEDETECTOR_H
+
+#include <random>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class PeopleDetector
+/// \brief Simulated people detector
+/// \details Turns the true positions of the persons around the sensor
+/// into detections in the sensor frame. Persons outside the field of
+/// view or range are dropped, the others are missed with a given
+/// probability and their positions are disturbed by gaussian noise.
+/// Additionally, false positives appear uniformly within the field of
+/// view.
+/// -----------------------------------------------------------------
+class PeopleDetector {
+public:
+    struct Person {
+        int id;
+        double x, y;
+    };
+    struct Detection {
+        int id; // id of the detected person, -1 for false positives
+        double x, y; // in the sensor frame
+        double confidence;
+    };
+
+    PeopleDetector(double fov, double range_max, double detection_probability,
+        double position_noise, double false_positives);
+    virtual ~PeopleDetector();
+
+    /// \brief detect the given persons (e.g. the ones within range_max)
+    /// from the sensor pose
+    void detect(double x, double y, double yaw, const std::vector<Person>& persons,
+        std::default_random_engine& generator, std::vector<Detection>& detections) const;
+
+    double getFieldOfView() const { return fov_; }
+    double getRangeMax() const { return range_max_; }
+    double getPositionNoise() const { return position_noise_; }
+
+protected:
+    double fov_; // full opening angle, centered at the sensor heading
+    double range_max_;
+    double detection_probability_;
+    double position_noise_; // standard deviation (m)
+    double false_positives_; // mean number per detection cycle
+};
+
+#endif
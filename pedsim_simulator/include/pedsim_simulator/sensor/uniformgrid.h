@@ -0,0 +1,195 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#ifndef UNIFORMGRID_H
+#define UNIFORMGRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/// -----------------------------------------------------------------
+/// \class UniformGrid
+/// \brief Dense grid of square cells holding item indices
+/// \details Used to find the candidate items along a ray without
+/// testing all of them. Rays are traversed cell by cell with a 2D DDA
+/// (Amanatides & Woo), so the cost of a ray is proportional to the
+/// number of cells it crosses.
+/// -----------------------------------------------------------------
+class UniformGrid {
+public:
+    UniformGrid()
+        : min_x_(0)
+        , min_y_(0)
+        , cell_size_(1)
+        , width_(0)
+        , height_(0)
+    {
+    }
+
+    /// drop all items and cover [min_x, max_x] x [min_y, max_y]
+    void reset(double min_x, double min_y, double max_x, double max_y, double cell_size)
+    {
+        cell_size_ = cell_size;
+        min_x_ = min_x;
+        min_y_ = min_y;
+        width_ = std::max(1, static_cast<int>(std::ceil((max_x - min_x) / cell_size)));
+        height_ = std::max(1, static_cast<int>(std::ceil((max_y - min_y) / cell_size)));
+
+        for (std::vector<int>& cell : cells_)
+            cell.clear();
+        cells_.resize(width_ * height_);
+    }
+
+    bool empty() const { return cells_.empty(); }
+
+    /// add an item to all cells overlapping the box
+    void insertBox(int item, double min_x, double min_y, double max_x, double max_y)
+    {
+        const int x0 = std::max(0, cellX(min_x)), x1 = std::min(width_ - 1, cellX(max_x));
+        const int y0 = std::max(0, cellY(min_y)), y1 = std::min(height_ - 1, cellY(max_y));
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                cells_[y * width_ + x].push_back(item);
+    }
+
+    /// add an item to all cells crossed by the segment
+    void insertSegment(int item, double ax, double ay, double bx, double by)
+    {
+        const double dx = bx - ax, dy = by - ay;
+        const double length = std::hypot(dx, dy);
+        if (length <= 0) {
+            insertBox(item, ax, ay, ax, ay);
+            return;
+        }
+
+        traverse(ax, ay, dx / length, dy / length, length, [this, item](int cell, double) {
+            cells_[cell].push_back(item);
+            return false;
+        });
+    }
+
+    /// items in a cell
+    const std::vector<int>& items(int cell) const { return cells_[cell]; }
+
+    /// index of the cell containing the point, -1 if outside
+    int cellIndex(double x, double y) const
+    {
+        const int cx = cellX(x), cy = cellY(y);
+        if (cx < 0 || cy < 0 || cx >= width_ || cy >= height_)
+            return -1;
+        return cy * width_ + cx;
+    }
+
+    /// \brief walk along the ray (unit direction) up to max_range
+    /// \details visitor(cell, t_exit) is called for every crossed cell in
+    /// order, t_exit is the ray parameter where the ray leaves that cell.
+    /// The walk stops when the visitor returns true.
+    template <typename Visitor>
+    void traverse(double ox, double oy, double dx, double dy, double max_range, Visitor visitor) const
+    {
+        if (cells_.empty())
+            return;
+
+        // → clip the ray against the grid bounds
+        double t_enter = 0, t_leave = max_range;
+        if (!clip(ox, dx, min_x_, min_x_ + width_ * cell_size_, t_enter, t_leave)
+            || !clip(oy, dy, min_y_, min_y_ + height_ * cell_size_, t_enter, t_leave))
+            return;
+
+        const double px = ox + t_enter * dx, py = oy + t_enter * dy;
+        int x = std::min(width_ - 1, std::max(0, cellX(px)));
+        int y = std::min(height_ - 1, std::max(0, cellY(py)));
+
+        const int step_x = dx > 0 ? 1 : -1;
+        const int step_y = dy > 0 ? 1 : -1;
+        const double inf = std::numeric_limits<double>::infinity();
+        const double delta_x = dx != 0 ? cell_size_ / std::fabs(dx) : inf;
+        const double delta_y = dy != 0 ? cell_size_ / std::fabs(dy) : inf;
+
+        // ray parameter of the next vertical/horizontal cell border
+        double next_x = inf, next_y = inf;
+        if (dx != 0) {
+            const double border = min_x_ + (x + (step_x > 0 ? 1 : 0)) * cell_size_;
+            next_x = (border - ox) / dx;
+        }
+        if (dy != 0) {
+            const double border = min_y_ + (y + (step_y > 0 ? 1 : 0)) * cell_size_;
+            next_y = (border - oy) / dy;
+        }
+
+        while (true) {
+            const double t_exit = std::min(std::min(next_x, next_y), t_leave);
+            if (visitor(y * width_ + x, t_exit) || t_exit >= t_leave)
+                return;
+
+            if (next_x < next_y) {
+                x += step_x;
+                next_x += delta_x;
+                if (x < 0 || x >= width_)
+                    return;
+            }
+            else {
+                y += step_y;
+                next_y += delta_y;
+                if (y < 0 || y >= height_)
+                    return;
+            }
+        }
+    }
+
+private:
+    int cellX(double x) const { return static_cast<int>(std::floor((x - min_x_) / cell_size_)); }
+    int cellY(double y) const { return static_cast<int>(std::floor((y - min_y_) / cell_size_)); }
+
+    // restrict [t_enter, t_leave] to the slab [lo, hi] along one axis
+    static bool clip(double o, double d, double lo, double hi, double& t_enter, double& t_leave)
+    {
+        if (d == 0)
+            return o >= lo && o <= hi;
+
+        double t0 = (lo - o) / d, t1 = (hi - o) / d;
+        if (t0 > t1)
+            std::swap(t0, t1);
+        t_enter = std::max(t_enter, t0);
+        t_leave = std::min(t_leave, t1);
+        return t_enter <= t_leave;
+    }
+
+    double min_x_;
+    double min_y_;
+    double cell_size_;
+    int width_;
+    int height_;
+    std::vector<std::vector<int> > cells_;
+};
+
+#endif
@@ -35,12 +35,21 @@
 #include <ros/console.h>
 #include <ros/ros.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <tf/transform_broadcaster.h>
 #include <tf/transform_listener.h>
 
 #include <pedsim_msgs/AgentState.h>
+#include <pedsim_msgs/AgentStatesDelta.h>
+#include <pedsim_msgs/AgentStatesPacked.h>
 #include <pedsim_msgs/AllAgentsState.h>
+#include <pedsim_msgs/CrowdGrid.h>
+#include <pedsim_msgs/DetectedPersons.h>
 #include <pedsim_msgs/SocialActivities.h>
 #include <pedsim_msgs/SocialActivity.h>
 #include <pedsim_msgs/TrackedGroup.h>
@@ -48,15 +57,23 @@
 #include <pedsim_msgs/TrackedPerson.h>
 #include <pedsim_msgs/TrackedPersons.h>
 
+#include <pedsim_srvs/GetAgentState.h>
+#include <pedsim_srvs/GetAllAgentsState.h>
+#include <pedsim_srvs/SetAgentState.h>
+#include <pedsim_srvs/SetAllAgentsState.h>
+
 // other ROS-sy messages
 #include <animated_marker_msgs/AnimatedMarker.h>
 #include <animated_marker_msgs/AnimatedMarkerArray.h>
 #include <geometry_msgs/Point.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/PoseWithCovariance.h>
+#include <geometry_msgs/Twist.h>
 #include <geometry_msgs/TwistWithCovariance.h>
 #include <nav_msgs/GridCells.h>
+#include <nav_msgs/OccupancyGrid.h>
 #include <nav_msgs/Odometry.h>
+#include <sensor_msgs/LaserScan.h>
 #include <std_msgs/ColorRGBA.h>
 #include <std_msgs/Header.h>
 #include <std_srvs/Empty.h>
@@ -66,14 +83,22 @@
 #include <pedsim_simulator/agentstatemachine.h>
 #include <pedsim_simulator/agentstatemachine.h>
 #include <pedsim_simulator/config.h>
+#include <pedsim_simulator/crowdgrid.h>
 #include <pedsim_simulator/element/agent.h>
 #include <pedsim_simulator/element/agentgroup.h>
 #include <pedsim_simulator/element/attractionarea.h>
 #include <pedsim_simulator/element/waitingqueue.h>
 #include <pedsim_simulator/element/waypoint.h>
+#include <pedsim_simulator/navigation/flowfieldrouter.h>
+#include <pedsim_simulator/navigation/visibilitygraphrouter.h>
 #include <pedsim_simulator/orientationhandler.h>
+#include <pedsim_simulator/realtime.h>
+#include <pedsim_simulator/robotkinematics.h>
 #include <pedsim_simulator/scenarioreader.h>
 #include <pedsim_simulator/scene.h>
+#include <pedsim_simulator/sensor/angulardepthbuffer.h>
+#include <pedsim_simulator/sensor/laserscanner.h>
+#include <pedsim_simulator/sensor/peopledetector.h>
 
 #include <dynamic_reconfigure/server.h>
 #include <pedsim_simulator/PedsimSimulatorConfig.h>
@@ -87,47 +112,96 @@ using SimConfig = pedsim_simulator::PedsimSimulatorConfig;
 /// -----------------------------------------------------------------
 class Simulator {
 public:
-    explicit Simulator(const ros::NodeHandle& node);
+    Simulator(const ros::NodeHandle& node, const ros::NodeHandle& private_node);
     virtual ~Simulator();
 
     bool initializeSimulation();
     void loadConfigParameters();
     void runSimulation();
+    void runRealtimeSimulation();
+    void simulateStep();
+    void stopSimulation(); // makes runSimulation return, thread safe
     void updateAgentActivities();
 
     /// publishers
     void publishAgents();
     void publishData();
+    void publishTrackedPersons(const QList<Agent*>& agents, ros::Publisher& publisher,
+        bool visible_only = false);
+    void publishTrackedPersonsLocal();
+    void publishTrackedGroups();
+    void publishAgentStatesPacked();
+    void publishAgentStatesDelta();
     void publishSocialActivities();
     void publishGroupVisuals();
     void publishObstacles();
     void publishWalls();
     void publishAttractions();
     void publishRobotPosition();
+    void publishLaserScan();
+    void publishDetectedPersons();
+    void publishCrowdGrid();
 
     // callbacks
     bool onPauseSimulation(std_srvs::Empty::Request& request,
         std_srvs::Empty::Response& response);
     bool onUnpauseSimulation(std_srvs::Empty::Request& request,
         std_srvs::Empty::Response& response);
+    bool onGetAgentState(pedsim_srvs::GetAgentState::Request& request,
+        pedsim_srvs::GetAgentState::Response& response);
+    bool onGetAllAgentsState(pedsim_srvs::GetAllAgentsState::Request& request,
+        pedsim_srvs::GetAllAgentsState::Response& response);
+    bool onSetAgentState(pedsim_srvs::SetAgentState::Request& request,
+        pedsim_srvs::SetAgentState::Response& response);
+    bool onSetAllAgentsState(pedsim_srvs::SetAllAgentsState::Request& request,
+        pedsim_srvs::SetAllAgentsState::Response& response);
+    void applyAgentState(Agent* agent, const pedsim_msgs::AgentState& state);
 
     // update robot position based upon data from TF
     void updateRobotPositionFromTF();
 
+    // robots driven by velocity commands within the simulation
+    void setupRobots();
+    void updateRobots();
+    void publishRobotOdometry();
+    void updateRobotHeading();
+
+    // move the agents in the density and velocity raster
+    void updateCrowdGrid();
+
+    // line of sight from the robot to all agents
+    void updateOcclusions();
+
+    // select the agents around the robot (and other frames of interest)
+    void updateAreaOfInterest();
+    const QList<Agent*>& getPublishedAgents() const;
+
 protected:
     void reconfigureCB(SimConfig& config, uint32_t level);
+    void applyPendingConfig();
     dynamic_reconfigure::Server<SimConfig> server_;
 
 private:
     ros::NodeHandle nh_;
-    bool paused_; // simulation state
+    ros::NodeHandle private_nh_;
+    std::atomic<bool> paused_; // simulation state, set by services
+    std::atomic<bool> stop_requested_;
+    std::mutex scene_mutex_; // held while a step is computed
+    // last dynamic reconfigure parameters, guarded by scene_mutex_
+    SimConfig pending_config_;
+    bool has_pending_config_;
 
     /// publishers
     // - data messages
     ros::Publisher pub_obstacles_; // grid cells
     ros::Publisher pub_all_agents_; // positions and velocities (old msg)
     ros::Publisher pub_tracked_persons_; // in spencer format
+    ros::Publisher pub_tracked_persons_full_; // whole scene, when filtering by area of interest
+    ros::Publisher pub_visible_persons_; // only persons the robot can see
+    ros::Publisher pub_tracked_persons_local_; // in the robot frame
     ros::Publisher pub_tracked_groups_;
+    ros::Publisher pub_agent_states_packed_; // compact states for high rates
+    ros::Publisher pub_agent_states_delta_; // only changes, with keyframes
     ros::Publisher pub_social_activities_;
     // - visualization related messages (e.g. markers)
     ros::Publisher pub_attractions_;
@@ -138,10 +212,20 @@ private:
     ros::Publisher pub_waypoints_;
     ros::Publisher pub_agent_arrows_;
     ros::Publisher pub_robot_position_;
+    ros::Publisher pub_laser_scan_;
+    ros::Publisher pub_detected_persons_;
+    ros::Publisher pub_crowd_density_; // density as occupancy grid
+    ros::Publisher pub_crowd_grid_; // density and mean velocities
+    ros::Publisher pub_crowd_density_local_;
+    ros::Publisher pub_crowd_grid_local_;
 
     // provided services
     ros::ServiceServer srv_pause_simulation_;
     ros::ServiceServer srv_unpause_simulation_;
+    ros::ServiceServer srv_get_agent_state_;
+    ros::ServiceServer srv_get_all_agents_state_;
+    ros::ServiceServer srv_set_agent_state_;
+    ros::ServiceServer srv_set_all_agents_state_;
 
     // agent id <-> activity map
     std::map<int, std::string> agent_activities_;
@@ -152,7 +236,90 @@ private:
     Agent* robot_; // robot agent
     tf::StampedTransform last_robot_pose_; // pose of robot in previous timestep
     geometry_msgs::Quaternion last_robot_orientation_;
+    double robot_heading_; // yaw of the robot in the odom frame
+    std::string robot_frame_; // frame of the robot centric messages
+
+    // real time loop (optional), what to do when a tick overruns:
+    // skip publishing, catch up with extra steps or let time fall behind
+    enum class OverrunPolicy { DROP_PUBLISH, SUBSTEP, SLOW_TIME };
+    bool realtime_;
+    OverrunPolicy overrun_policy_;
+    int max_catch_up_steps_;
+    int catch_up_steps_; // extra steps in the next tick
+    bool skip_publishing_; // in the next tick
+    realtime::TickStatistics tick_statistics_;
+    void setupRealtimeThread();
+
+    // robots integrated in the simulation step (instead of TF)
+    struct SimulatedRobot {
+        Agent* agent;
+        RobotKinematics kinematics;
+        std::string frame;
+        ros::Subscriber sub_cmd_vel;
+        ros::Publisher pub_odom;
+        ros::Time last_command;
+    };
+    std::vector<std::unique_ptr<SimulatedRobot> > robots_;
+    bool internal_kinematics_;
+    RobotKinematics::Model kinematics_model_;
+    double cmd_vel_timeout_;
+    std::unique_ptr<tf::TransformBroadcaster> transform_broadcaster_;
+    void onCmdVel(const geometry_msgs::Twist::ConstPtr& msg, SimulatedRobot* robot);
+
+    // occlusions as seen from the robot
+    bool compute_occlusions_;
+    AngularDepthBuffer depth_buffer_;
+    std::unordered_set<int> occluded_agents_;
+
+    // simulated laser scanner mounted on the robot (optional)
+    std::unique_ptr<LaserScanner> laser_scanner_;
+    std::string laser_frame_;
+    double laser_period_; // in simulated time
+    double laser_next_scan_time_;
+    int laser_walls_revision_;
+
+    // simulated people detector on the robot (optional)
+    std::unique_ptr<PeopleDetector> people_detector_;
+    std::string detector_frame_;
+    double detector_period_; // in simulated time
+    double detector_next_time_;
+    uint64_t detection_id_counter_;
+
+    // crowd density and velocity raster (optional)
+    std::unique_ptr<CrowdGrid> crowd_grid_;
+    double crowd_grid_period_; // in simulated time
+    double crowd_grid_next_time_;
+    double crowd_grid_local_size_; // side length of the crop around the robot
+    double crowd_grid_max_density_; // maps to 100 in the occupancy grids
+
+    // cells [x0, x0 + width) x [y0, y0 + height) of the crowd grid
+    void fillCrowdGrid(int x0, int y0, int width, int height,
+        nav_msgs::OccupancyGrid& density, pedsim_msgs::CrowdGrid& grid);
+
+    // revisions of the latched static obstacle messages (-1: not yet published)
+    int obstacles_revision_;
+    int walls_revision_;
+
+    // area of interest, disabled if the radius is not positive
+    double aoi_radius_;
+    std::vector<std::string> aoi_frames_;
+    QList<Agent*> aoi_agents_;
+
+    // delta encoding of the agent states
+    struct SentAgentState {
+        float x, y, vx, vy;
+        uint8_t state;
+    };
+    std::unordered_map<int, SentAgentState> delta_sent_states_; // as last sent
+    uint32_t delta_sequence_;
+    int delta_ticks_since_keyframe_; // -1 forces a keyframe
+    int delta_keyframe_interval_;
+    double delta_position_threshold_;
+    double delta_velocity_threshold_;
 
+    void reserveAgentStates(pedsim_msgs::AgentStatesPacked& packed, size_t num_agents);
+    void appendAgentState(pedsim_msgs::AgentStatesPacked& packed, const Agent* a);
+    pedsim_msgs::AgentState agentToState(const Agent* a);
     inline Eigen::Quaternionf computePose(Agent* a);
     inline std::string agentStateToActivity(AgentStateMachine::AgentState state);
     inline std_msgs::ColorRGBA getColor(int agent_id);
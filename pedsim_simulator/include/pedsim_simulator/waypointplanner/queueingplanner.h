@@ -54,17 +54,16 @@ class QueueingWaypointPlanner : public WaypointPlanner {
 public:
     QueueingWaypointPlanner();
 
-    // Slots
-protected slots:
-    void onFollowedAgentPositionChanged(double xIn, double yIn);
-    void onAgentMayPassQueue(int id);
-    void onFollowedAgentLeftQueue();
-    void onQueueEndPositionChanged(double xIn, double yIn);
-
     // Methods
 public:
     void reset();
 
+    // → updates from the waiting queue
+    void onQueueEndPositionChanged(double xIn, double yIn);
+    void setQueueingPosition(const Ped::Tvector& positionIn, bool force);
+    void onMayPass();
+    bool isApproaching() const;
+
     // → Agent
     virtual Agent* getAgent() const;
     virtual bool setAgent(Agent* agentIn);
@@ -99,7 +98,6 @@ protected:
     // → WaitingQueue
     WaitingQueue* waitingQueue;
     Waypoint* currentWaypoint;
-    const Agent* followedAgent;
     QueueingStatus status;
 };
 
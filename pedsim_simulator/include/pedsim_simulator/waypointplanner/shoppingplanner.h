@@ -35,6 +35,7 @@
 
 #include <pedsim_simulator/waypointplanner/waypointplanner.h>
 #include <pedsim/ped_vector.h>
+#include <pedsim_simulator/eventscheduler.h>
 
 
 // Forward Declarations
@@ -49,6 +50,7 @@ class ShoppingPlanner : public WaypointPlanner
 	// Constructor and Destructor
 public:
 	ShoppingPlanner();
+	virtual ~ShoppingPlanner();
 
 
 	// Signals
@@ -73,6 +75,7 @@ protected:
 	QString createWaypointName() const;
 	Ped::Tvector getRandomAttractionPosition() const;
 	Ped::Tvector createRandomOffset() const;
+	void resetDwellTime();
 
 	// → WaypointPlanner Overrides
 public:
@@ -91,6 +94,9 @@ protected:
 	// → Waypoints
 	Waypoint* currentWaypoint;
 	double timeReached;
+	// → the dwell time at the waypoint is a scene event
+	EventScheduler::EventId dwellEvent;
+	bool dwellCompleted;
 };
 
 #endif
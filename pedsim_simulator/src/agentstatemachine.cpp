@@ -44,6 +44,8 @@
 
 #include <ros/ros.h>
 
+#include <algorithm>
+
 AgentStateMachine::AgentStateMachine(Agent* agentIn)
 {
     // initialize values
@@ -54,6 +56,7 @@ AgentStateMachine::AgentStateMachine(Agent* agentIn)
     shoppingPlanner = nullptr;
     groupAttraction = nullptr;
     shallLoseAttraction = false;
+    attractionLossEvent = 0;
 
     // initialize state machine
     state = StateNone;
@@ -62,6 +65,7 @@ AgentStateMachine::AgentStateMachine(Agent* agentIn)
 AgentStateMachine::~AgentStateMachine()
 {
     // clean up
+    SCENE.cancelEvent(attractionLossEvent);
     delete individualPlanner;
     delete queueingPlanner;
     delete groupWaypointPlanner;
@@ -74,6 +78,27 @@ void AgentStateMachine::loseAttraction()
     shallLoseAttraction = true;
 }
 
+void AgentStateMachine::scheduleAttractionLoss()
+{
+    // the agent loses the attraction with a probability per tick,
+    // draw the number of ticks until that happens once instead
+    //TODO: make this dependent from the distance to CoM
+    const double timeStep = CONFIG.getTimeStepSize();
+    const double probability = std::min(0.03 * timeStep, 1.0);
+    if (probability <= 0)
+        return;
+
+    std::geometric_distribution<int> failedTrials(probability);
+    const int ticks = failedTrials(RNG()) + 1;
+
+    // half a step early, so rounding of the scene time can't delay it by a tick
+    SCENE.cancelEvent(attractionLossEvent);
+    attractionLossEvent = SCENE.scheduleEvent(SCENE.getTime() + (ticks - 0.5) * timeStep, [this]() {
+        attractionLossEvent = 0;
+        loseAttraction();
+    });
+}
+
 void AgentStateMachine::doStateTransition()
 {
     // determine new state
@@ -91,7 +116,10 @@ void AgentStateMachine::doStateTransition()
             return;
         } else {
             //TODO: attraction must be visible!
-            attraction = SCENE.getClosestAttraction(agent->getPosition(), &distance);
+            // → attractions further away than this have no influence, agents
+            //   outside of all influence zones skip the test
+            double maxAttractionDist = 7;
+            attraction = SCENE.getClosestAttractionWithin(agent->getPosition(), maxAttractionDist, &distance);
 
             if (attraction != nullptr) {
                 // check whether agent is attracted
@@ -99,7 +127,6 @@ void AgentStateMachine::doStateTransition()
                 //       number of Bernoulli trials needed to get one success.
                 //       → CDF(X) = 1-(1-p)^k   with k = the number of trials
                 double baseProbability = 0.02;
-                double maxAttractionDist = 7;
                 // → probability dependents on strength, distance,
                 //   and whether another group member are attracted
                 double probability = baseProbability
@@ -116,14 +143,9 @@ void AgentStateMachine::doStateTransition()
             }
         }
     }
-    // → randomly lose attraction
+    // → lose attraction (randomly, see scheduleAttractionLoss)
     if (state == StateShopping) {
-        // check whether agent loses attraction
-        //TODO: make this dependent from the distance to CoM
-        double probability = 0.03;
-        std::bernoulli_distribution isAttracted(probability * CONFIG.getTimeStepSize());
-
-        if (shallLoseAttraction || isAttracted(RNG())) {
+        if (shallLoseAttraction) {
             // reactivate previous state
             activateState(normalState);
 
@@ -199,6 +221,7 @@ void AgentStateMachine::activateState(AgentState stateIn)
         break;
     case StateShopping:
         shallLoseAttraction = false;
+        scheduleAttractionLoss();
         if (shoppingPlanner == nullptr)
             shoppingPlanner = new ShoppingPlanner();
         AttractionArea* attraction = SCENE.getClosestAttraction(agent->getPosition());
@@ -247,6 +270,9 @@ void AgentStateMachine::deactivateState(AgentState state)
         // nothing to do
         break;
     case StateShopping:
+        SCENE.cancelEvent(attractionLossEvent);
+        attractionLossEvent = 0;
+
         // inform other group members
         shoppingPlanner->loseAttraction();
 
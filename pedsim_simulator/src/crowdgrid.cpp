@@ -0,0 +1,131 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/crowdgrid.h>
+
+#include <algorithm>
+#include <cmath>
+
+CrowdGrid::CrowdGrid()
+    : origin_x_(0)
+    , origin_y_(0)
+    , resolution_(1.0)
+    , cell_area_(1.0)
+    , width_(0)
+    , height_(0)
+    , tick_(0)
+{
+}
+
+CrowdGrid::~CrowdGrid() {}
+
+void CrowdGrid::resize(double origin_x, double origin_y, double width, double height, double resolution)
+{
+    origin_x_ = origin_x;
+    origin_y_ = origin_y;
+    resolution_ = resolution;
+    cell_area_ = resolution * resolution;
+    width_ = std::max(1, static_cast<int>(std::ceil(width / resolution)));
+    height_ = std::max(1, static_cast<int>(std::ceil(height / resolution)));
+
+    const size_t num_cells = static_cast<size_t>(width_) * height_;
+    count_.assign(num_cells, 0);
+    vx_sum_.assign(num_cells, 0.0);
+    vy_sum_.assign(num_cells, 0.0);
+    entries_.clear();
+}
+
+int CrowdGrid::cellIndex(double x, double y) const
+{
+    const int cx = static_cast<int>(std::floor((x - origin_x_) / resolution_));
+    const int cy = static_cast<int>(std::floor((y - origin_y_) / resolution_));
+    if (cx < 0 || cy < 0 || cx >= width_ || cy >= height_)
+        return -1;
+    return cy * width_ + cx;
+}
+
+void CrowdGrid::add(int cell, double vx, double vy)
+{
+    if (cell < 0)
+        return;
+    count_[cell]++;
+    vx_sum_[cell] += vx;
+    vy_sum_[cell] += vy;
+}
+
+void CrowdGrid::remove(int cell, double vx, double vy)
+{
+    if (cell < 0)
+        return;
+    count_[cell]--;
+    vx_sum_[cell] -= vx;
+    vy_sum_[cell] -= vy;
+
+    // → avoid drift of the sums from rounding
+    if (count_[cell] == 0) {
+        vx_sum_[cell] = 0.0;
+        vy_sum_[cell] = 0.0;
+    }
+}
+
+void CrowdGrid::beginUpdate()
+{
+    tick_++;
+}
+
+void CrowdGrid::update(int id, double x, double y, double vx, double vy)
+{
+    const int cell = cellIndex(x, y);
+
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+        entries_[id] = { cell, vx, vy, tick_ };
+        add(cell, vx, vy);
+        return;
+    }
+
+    Entry& entry = it->second;
+    remove(entry.cell, entry.vx, entry.vy);
+    add(cell, vx, vy);
+    entry = { cell, vx, vy, tick_ };
+}
+
+void CrowdGrid::endUpdate()
+{
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.tick != tick_) {
+            remove(it->second.cell, it->second.vx, it->second.vy);
+            it = entries_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
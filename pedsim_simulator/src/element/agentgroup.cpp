@@ -33,6 +33,136 @@
 #include <pedsim_simulator/element/agent.h>
 #include <pedsim_simulator/element/agentgroup.h>
 #include <pedsim_simulator/rng.h>
+#include <pedsim_simulator/scene.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+// Temporary grid over the agents of a cluster, for group formation.
+// Assigned agents are removed from their cell in O(1).
+class ClusterIndex {
+public:
+    explicit ClusterIndex(const QList<Agent*>& agentsIn)
+        : agents(agentsIn)
+    {
+        const int count = agents.size();
+        positions.reserve(count);
+        double minX = 0, minY = 0, maxX = 0, maxY = 0;
+        for (int i = 0; i < count; ++i) {
+            const Ped::Tvector position = agents[i]->getPosition();
+            positions.push_back(position);
+            if (i == 0 || position.x < minX)
+                minX = position.x;
+            if (i == 0 || position.y < minY)
+                minY = position.y;
+            if (i == 0 || position.x > maxX)
+                maxX = position.x;
+            if (i == 0 || position.y > maxY)
+                maxY = position.y;
+        }
+
+        // → about two agents per cell
+        const double area = (maxX - minX) * (maxY - minY);
+        cellSize = (count > 0 && area > 0) ? std::sqrt(2.0 * area / count) : 1.0;
+        cellSize = std::max(cellSize, 0.1);
+        originX = minX;
+        originY = minY;
+        width = static_cast<int>((maxX - minX) / cellSize) + 1;
+        height = static_cast<int>((maxY - minY) / cellSize) + 1;
+
+        cells.resize(static_cast<size_t>(width) * height);
+        cellOf.resize(count);
+        slotOf.resize(count);
+        for (int i = 0; i < count; ++i) {
+            const int cell = cellIndex(positions[i]);
+            cellOf[i] = cell;
+            slotOf[i] = static_cast<int>(cells[cell].size());
+            cells[cell].push_back(i);
+        }
+    }
+
+    void remove(int agent)
+    {
+        std::vector<int>& cell = cells[cellOf[agent]];
+        const int slot = slotOf[agent];
+        const int last = cell.back();
+        cell[slot] = last;
+        slotOf[last] = slot;
+        cell.pop_back();
+    }
+
+    // the k closest agents to the given one that are still in the index,
+    // closest first
+    void nearest(int agent, int k, std::vector<int>& result) const
+    {
+        result.clear();
+        if (k <= 0)
+            return;
+
+        const Ped::Tvector& center = positions[agent];
+        const int cx = static_cast<int>((center.x - originX) / cellSize);
+        const int cy = static_cast<int>((center.y - originY) / cellSize);
+        const int maxRing = std::max(width, height);
+
+        // max heap on the distance, keeps the k best candidates
+        std::vector<std::pair<double, int> > best;
+        for (int ring = 0; ring <= maxRing; ++ring) {
+            // → all cells in this ring are at least (ring - 1) cells away
+            if (static_cast<int>(best.size()) == k && (ring - 1) * cellSize > best.front().first)
+                break;
+
+            for (int y = cy - ring; y <= cy + ring; ++y) {
+                if (y < 0 || y >= height)
+                    continue;
+                const bool edgeRow = (y == cy - ring || y == cy + ring);
+                for (int x = cx - ring; x <= cx + ring; x += (edgeRow ? 1 : 2 * ring)) {
+                    if (x >= 0 && x < width) {
+                        for (int other : cells[y * width + x]) {
+                            if (other == agent)
+                                continue;
+                            const double distance = (center - positions[other]).length();
+                            if (static_cast<int>(best.size()) < k) {
+                                best.push_back(std::make_pair(distance, other));
+                                std::push_heap(best.begin(), best.end());
+                            }
+                            else if (distance < best.front().first) {
+                                std::pop_heap(best.begin(), best.end());
+                                best.back() = std::make_pair(distance, other);
+                                std::push_heap(best.begin(), best.end());
+                            }
+                        }
+                    }
+                    if (ring == 0)
+                        break;
+                }
+            }
+        }
+
+        std::sort_heap(best.begin(), best.end());
+        for (const auto& candidate : best)
+            result.push_back(candidate.second);
+    }
+
+protected:
+    int cellIndex(const Ped::Tvector& position) const
+    {
+        const int x = std::min(width - 1, std::max(0, static_cast<int>((position.x - originX) / cellSize)));
+        const int y = std::min(height - 1, std::max(0, static_cast<int>((position.y - originY) / cellSize)));
+        return y * width + x;
+    }
+
+    const QList<Agent*>& agents;
+    std::vector<Ped::Tvector> positions;
+    double cellSize;
+    double originX, originY;
+    int width, height;
+    std::vector<std::vector<int> > cells;
+    std::vector<int> cellOf; // cell of each agent
+    std::vector<int> slotOf; // position within the cell
+};
+}
 
 AgentGroup::AgentGroup()
 {
@@ -40,16 +170,8 @@ AgentGroup::AgentGroup()
     id_ = staticid++;
 
     // initialize values
-    dirty = true;
-    dirtyMaxDistance = true;
+    aggregateIndex = -1;
     recollecting = true;
-    // → delayed center of mass update
-    comUpdateTimer.setSingleShot(true);
-    comUpdateTimer.setInterval(0);
-    connect(&comUpdateTimer, SIGNAL(timeout()), this, SLOT(updateCenterOfMass()));
-
-    // compute center of mass
-    updateCenterOfMass();
 }
 
 AgentGroup::AgentGroup(const QList<Agent*>& agentsIn)
@@ -58,21 +180,9 @@ AgentGroup::AgentGroup(const QList<Agent*>& agentsIn)
     id_ = staticid++;
 
     // initialize values
-    dirty = true;
-    dirtyMaxDistance = true;
+    aggregateIndex = -1;
+    recollecting = true;
     members = agentsIn;
-    // → delayed center of mass update
-    comUpdateTimer.setSingleShot(false);
-    comUpdateTimer.setInterval(0);
-    connect(&comUpdateTimer, SIGNAL(timeout()), this, SLOT(updateCenterOfMass()));
-
-    // compute center of mass
-    updateCenterOfMass();
-
-    // connect signals
-    foreach (Agent* agent, members)
-        connect(agent, SIGNAL(positionChanged(double, double)),
-            this, SLOT(onPositionChanged(double, double)));
 }
 
 AgentGroup::AgentGroup(std::initializer_list<Agent*>& agentsIn)
@@ -81,39 +191,21 @@ AgentGroup::AgentGroup(std::initializer_list<Agent*>& agentsIn)
     id_ = staticid++;
 
     // initialize values
-    dirty = true;
-    dirtyMaxDistance = true;
-    comUpdateTimer.setSingleShot(true);
-    comUpdateTimer.setInterval(0);
-    connect(&comUpdateTimer, SIGNAL(timeout()), this, SLOT(updateCenterOfMass()));
+    aggregateIndex = -1;
+    recollecting = true;
 
     // add agents from initializer_list to the member list
-    for (Agent* currentAgent : agentsIn) {
+    for (Agent* currentAgent : agentsIn)
         members.append(currentAgent);
-        connect(currentAgent, SIGNAL(positionChanged(double, double)),
-            this, SLOT(onPositionChanged(double, double)));
-    }
-
-    // compute center of mass
-    updateCenterOfMass();
 }
 
 AgentGroup::~AgentGroup()
 {
 }
 
-void AgentGroup::onPositionChanged(double x, double y)
-{
-    // mark center of mass as dirty (needs to be re-calculated)
-    dirty = true;
-    dirtyMaxDistance = true;
-    comUpdateTimer.start();
-}
-
 QList<AgentGroup*> AgentGroup::divideAgents(const QList<Agent*>& agentsIn)
 {
     QList<AgentGroup*> groups;
-    QList<Agent*> unassignedAgents = agentsIn;
 
     // initialize Poisson distribution
     std::poisson_distribution<int> distribution(CONFIG.group_size_lambda);
@@ -146,12 +238,23 @@ QList<AgentGroup*> AgentGroup::divideAgents(const QList<Agent*>& agentsIn)
     reportSizeDistribution(sizeDistribution);
 
     if (CONFIG.groups_enabled) {
+        // → spatial index over the cluster for the neighbor queries
+        ClusterIndex index(agentsIn);
+        std::vector<bool> assigned(agentCount, false);
+        std::vector<int> neighbors;
+        int nextLeader = 0;
+
         // → iterate over all group sizes and create groups accordingly
         //   (start with the largest size to receive contiguous groups)
         for (int groupSize = sizeDistribution.count(); groupSize > 0; --groupSize) {
             // create groups of given size
             for (int groupIter = 0; groupIter < sizeDistribution[groupSize - 1]; ++groupIter) {
-                Agent* groupLeader = unassignedAgents.takeFirst();
+                // the first unassigned agent leads the group
+                while (assigned[nextLeader])
+                    ++nextLeader;
+                const int leader = nextLeader;
+                assigned[leader] = true;
+                index.remove(leader);
 
                 // create a group
                 AgentGroup* newGroup = new AgentGroup();
@@ -159,37 +262,16 @@ QList<AgentGroup*> AgentGroup::divideAgents(const QList<Agent*>& agentsIn)
                 groups.append(newGroup);
 
                 // add first agent to the group
-                Ped::Tvector leaderPosition = groupLeader->getPosition();
-                newGroup->addMember(groupLeader);
-
-                // add other agents to group
-                QList<QPair<Agent*, double> > distanceList;
-                foreach (Agent* potentialMember, unassignedAgents) {
-                    Ped::Tvector position = potentialMember->getPosition();
-                    double distance = (leaderPosition - position).length();
-
-                    // add potential group member to the list according to the distance
-                    auto iter = distanceList.begin();
-                    while (iter < distanceList.end()) {
-                        if (distance > iter->second)
-                            break;
-                        else
-                            ++iter;
-                    }
-                    // → insert candidate
-                    distanceList.insert(iter, qMakePair(potentialMember, distance));
+                newGroup->addMember(agentsIn[leader]);
 
-                    // reduce list if necessary
-                    if (distanceList.size() > groupSize - 1)
-                        distanceList.removeFirst();
-                }
-
-                // add neighbors to the group
-                foreach (const auto& member, distanceList) {
-                    newGroup->addMember(member.first);
+                // add the closest unassigned agents to the group
+                index.nearest(leader, groupSize - 1, neighbors);
+                for (int member : neighbors) {
+                    newGroup->addMember(agentsIn[member]);
 
                     // don't consider the group member as part of another group
-                    unassignedAgents.removeOne(member.first);
+                    assigned[member] = true;
+                    index.remove(member);
                 }
             }
         }
@@ -215,15 +297,9 @@ bool AgentGroup::addMember(Agent* agentIn)
         return false;
     }
 
-    // add Agent to the group and mark cache invalid
+    // add Agent to the group and mark the aggregates outdated
     members.append(agentIn);
-    dirty = true;
-    dirtyMaxDistance = true;
-    comUpdateTimer.start();
-
-    // connect signals
-    connect(agentIn, SIGNAL(positionChanged(double, double)),
-        this, SLOT(onPositionChanged(double, double)));
+    aggregateIndex = -1;
 
     // inform users
     emit memberAdded(agentIn->getId());
@@ -237,14 +313,8 @@ bool AgentGroup::removeMember(Agent* agentIn)
 
     // mark cache invalid, if the agent has been removed
     if (hasRemovedMember == true) {
-        // disconnect signals
-        disconnect(agentIn, SIGNAL(positionChanged(double, double)),
-            this, SLOT(onPositionChanged(double, double)));
-
-        // invalidate cache and schedule update
-        dirty = true;
-        dirtyMaxDistance = true;
-        comUpdateTimer.start();
+        // mark the aggregates outdated
+        aggregateIndex = -1;
 
         // inform users
         emit memberRemoved(agentIn->getId());
@@ -258,16 +328,9 @@ bool AgentGroup::removeMember(Agent* agentIn)
 
 bool AgentGroup::setMembers(const QList<Agent*>& agentsIn)
 {
-    // set the new members and mark cache invalid
+    // set the new members and mark the aggregates outdated
     members = agentsIn;
-    dirty = true;
-    dirtyMaxDistance = true;
-    comUpdateTimer.start();
-
-    // connect signals
-    foreach (Agent* agent, members)
-        connect(agent, SIGNAL(positionChanged(double, double)),
-            this, SLOT(onPositionChanged(double, double)));
+    aggregateIndex = -1;
 
     // inform users
     // TODO - we need to get away from using signals
@@ -288,21 +351,16 @@ int AgentGroup::memberCount() const
 
 Ped::Tvector AgentGroup::getCenterOfMass() const
 {
-    // check cache
-    if (dirty) {
-        // update cache
-        AgentGroup* nonConstThis = const_cast<AgentGroup*>(this);
-        nonConstThis->updateCenterOfMass();
-    }
+    // computed once per tick for all groups of the scene
+    const Scene::GroupAggregate* aggregate = SCENE.getGroupAggregate(this);
+    if (aggregate != nullptr)
+        return aggregate->centerOfMass;
 
-    return cacheCoM;
+    return computeCenterOfMass();
 }
 
-Ped::Tvector AgentGroup::updateCenterOfMass()
+Ped::Tvector AgentGroup::computeCenterOfMass() const
 {
-    if (!dirty)
-        return cacheCoM;
-
     // compute center of mass
     Ped::Tvector com;
     foreach (const Agent* member, members) {
@@ -310,15 +368,10 @@ Ped::Tvector AgentGroup::updateCenterOfMass()
     }
 
     int groupSize = members.size();
-    com /= groupSize;
+    if (groupSize > 0)
+        com /= groupSize;
 
-    // set cache value
-    cacheCoM = com;
-
-    // mark the cache as valid
-    dirty = false;
-
-    return cacheCoM;
+    return com;
 }
 
 void AgentGroup::setRecollect(bool recollectIn)
@@ -346,25 +399,20 @@ bool AgentGroup::isRecollecting() const
     return recollecting;
 }
 
-double AgentGroup::getMaxDistance()
+double AgentGroup::getMaxDistance() const
 {
-    if (dirty || dirtyMaxDistance)
-        updateMaxDistance();
+    const Scene::GroupAggregate* aggregate = SCENE.getGroupAggregate(this);
+    if (aggregate != nullptr)
+        return aggregate->maxDistance;
 
-    return cacheMaxDistance;
-}
-
-void AgentGroup::updateMaxDistance()
-{
-    Ped::Tvector com = getCenterOfMass();
+    Ped::Tvector com = computeCenterOfMass();
     double maxDistance = 0;
     foreach (Agent* agent, members) {
         double distance = (com - agent->getPosition()).length();
         if (distance > maxDistance)
             maxDistance = distance;
     }
-    cacheMaxDistance = maxDistance;
-    dirtyMaxDistance = false;
+    return maxDistance;
 }
 
 void AgentGroup::reportSizeDistribution(const QVector<int>& sizeDistributionIn)
@@ -389,5 +437,6 @@ QString AgentGroup::toString() const
         firstMember = false;
     }
 
-    return tr("AgentGroup (CoM: @%1,%2; Members:%3)").arg(cacheCoM.x).arg(cacheCoM.y).arg(agentString);
+    const Ped::Tvector com = computeCenterOfMass();
+    return tr("AgentGroup (CoM: @%1,%2; Members:%3)").arg(com.x).arg(com.y).arg(agentString);
 }
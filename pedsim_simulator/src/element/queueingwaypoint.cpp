@@ -30,6 +30,7 @@
 */
 
 #include <pedsim_simulator/element/queueingwaypoint.h>
+#include <pedsim_simulator/scene.h>
 #include <pedsim/ped_agent.h>
 
 
@@ -37,6 +38,7 @@
 QueueingWaypoint::QueueingWaypoint ( const QString& nameIn, const Ped::Tvector& positionIn )
     : Waypoint ( nameIn, positionIn )
 {
+    routingWaypoint = nullptr;
 }
 
 QueueingWaypoint::~QueueingWaypoint()
@@ -48,6 +50,11 @@ QString QueueingWaypoint::getName() const
     return name;
 }
 
+void QueueingWaypoint::setRoutingWaypoint ( const Waypoint* waypointIn )
+{
+    routingWaypoint = waypointIn;
+}
+
 Ped::Tvector QueueingWaypoint::getForce ( const Ped::Tagent& agentIn,
                                          Ped::Tvector* desiredDirectionOut,
                                          bool* reached ) const
@@ -63,7 +70,11 @@ Ped::Tvector QueueingWaypoint::getForce ( const Ped::Tagent& agentIn,
     if ( distance >= distanceThreshold )
     {
         // trivial case: agent is far away
-        Ped::Tvector desiredDirection = diff.normalized();
+        // → walk around obstacles in the way to the queue
+        Ped::Tvector desiredDirection;
+        if ( ( routingWaypoint == nullptr )
+                || !SCENE.getRoutedDirection ( agentIn.getId(), routingWaypoint, agentIn.getPosition(), position, &desiredDirection ) )
+            desiredDirection = diff.normalized();
         Ped::Tvector force = ( desiredDirection * agentIn.getVmax() - agentIn.getVelocity() ) / agentIn.getRelaxationTime();
         if ( desiredDirectionOut != nullptr )
 		{
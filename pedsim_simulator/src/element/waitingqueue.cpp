@@ -33,56 +33,99 @@
 #include <pedsim_simulator/rng.h>
 #include <pedsim_simulator/scene.h>
 #include <pedsim_simulator/element/agent.h>
+#include <pedsim_simulator/waypointplanner/queueingplanner.h>
 #include <pedsim_simulator/config.h>
 
+#include <algorithm>
 
 WaitingQueue::WaitingQueue ( const QString& nameIn, Ped::Tvector positionIn, Ped::Tangle directionIn )
     : Waypoint ( nameIn, positionIn ), direction ( directionIn )
 {
     // initialize values
     dequeueTime = INFINITY;
+    dequeueEvent = 0;
     waitDurationLambda = CONFIG.wait_time_beta;
-
-    // connect signals
-    connect ( &SCENE, SIGNAL ( sceneTimeChanged ( double ) ), this, SLOT ( onTimeChanged ( double ) ) );
+    endPositionChanged = true;
 }
 
 WaitingQueue::~WaitingQueue()
 {
+    SCENE.cancelEvent ( dequeueEvent );
 }
 
-void WaitingQueue::onTimeChanged ( double timeIn )
+void WaitingQueue::onDequeueTime()
 {
+    // the event is done
+    dequeueEvent = 0;
+
     // skip when there is none
-    if ( queuedAgents.empty() )
+    if ( queueSlots.empty() )
     {
         return;
     }
 
-    Agent* firstInLine = queuedAgents.first();
+    // let first agent in line pass, only its planner needs to know
+    QueueSlot& firstInLine = queueSlots.front();
+    if ( !firstInLine.planner.isNull() )
+        firstInLine.planner->onMayPass();
+
+    dequeueAgent ( firstInLine.agent );
+}
 
-    // check whether waiting started
-    if ( std::isinf ( dequeueTime ) )
+void WaitingQueue::updateQueue()
+{
+    // → every agent in line follows the one ahead of it
+    const Agent* aheadAgent = nullptr;
+    for ( QueueSlot& slot : queueSlots )
     {
-        if ( hasReachedWaitingPosition() )
+        Ped::Tvector queueingPosition = position;
+        if ( aheadAgent != nullptr )
         {
-            // set the time when to dequeue leading agent
-            startDequeueTime();
+            queueingPosition = aheadAgent->getPosition()
+                               - Ped::Tvector::fromPolar ( direction + slot.heading, slot.spacing );
         }
+
+        // a new agent ahead is followed right away
+        if ( !slot.planner.isNull() )
+            slot.planner->setQueueingPosition ( queueingPosition, slot.ahead != aheadAgent );
+
+        slot.ahead = aheadAgent;
+        aheadAgent = slot.agent;
     }
 
-    // let first agent in line pass
-    if ( dequeueTime <= timeIn )
+    // → check whether waiting started
+    if ( std::isinf ( dequeueTime ) && hasReachedWaitingPosition() )
     {
-        // dequeue agent and inform users
-        emit agentMayPass ( firstInLine->getId() );
-        dequeueAgent ( firstInLine );
+        // set the time when to dequeue leading agent
+        startDequeueTime();
     }
-}
 
-void WaitingQueue::onLastAgentPositionChanged ( double xIn, double yIn )
-{
-    emit queueEndPositionChanged ( xIn, yIn );
+    // → agents approaching the queue follow its end
+    if ( approachingPlanners.empty() )
+        return;
+
+    Ped::Tvector endPosition = getQueueEndPosition();
+    if ( endPositionChanged || ( endPosition != lastEndPosition ) )
+    {
+        lastEndPosition = endPosition;
+        endPositionChanged = false;
+
+        // note: planners reaching the end are enqueued in this loop
+        for ( size_t i = 0; i < approachingPlanners.size(); i++ )
+        {
+            QueueingWaypointPlanner* planner = approachingPlanners[i];
+            if ( ( planner != nullptr ) && planner->isApproaching() )
+                planner->onQueueEndPositionChanged ( endPosition.x, endPosition.y );
+        }
+    }
+
+    // forget planners that stopped approaching
+    approachingPlanners.erase ( std::remove_if ( approachingPlanners.begin(), approachingPlanners.end(),
+                                [] ( const QPointer<QueueingWaypointPlanner>& planner )
+    {
+        return planner.isNull() || !planner->isApproaching();
+    } ),
+    approachingPlanners.end() );
 }
 
 Ped::Tangle WaitingQueue::getDirection() const
@@ -113,24 +156,44 @@ void WaitingQueue::setDirection ( const Ped::Tvector& directionIn )
 
 bool WaitingQueue::isEmpty() const
 {
-    return queuedAgents.isEmpty();
+    return queueSlots.empty();
 }
 
 Ped::Tvector WaitingQueue::getQueueEndPosition() const
 {
-    if ( queuedAgents.isEmpty() )
+    if ( queueSlots.empty() )
         return position;
     else
-        return queuedAgents.last()->getPosition();
+        return queueSlots.back().agent->getPosition();
 }
 
-const Agent* WaitingQueue::enqueueAgent ( Agent* agentIn )
+void WaitingQueue::addApproachingPlanner ( QueueingWaypointPlanner* plannerIn )
 {
-    // determine output
-    const Agent* aheadAgent = ( queuedAgents.isEmpty() ) ?nullptr:queuedAgents.last();
+    if ( std::find ( approachingPlanners.begin(), approachingPlanners.end(), plannerIn ) == approachingPlanners.end() )
+        approachingPlanners.push_back ( plannerIn );
+
+    // tell the new planner where the queue ends
+    endPositionChanged = true;
+}
+
+void WaitingQueue::removeApproachingPlanner ( QueueingWaypointPlanner* plannerIn )
+{
+    approachingPlanners.erase ( std::remove ( approachingPlanners.begin(), approachingPlanners.end(), plannerIn ),
+                                approachingPlanners.end() );
+}
+
+Ped::Tvector WaitingQueue::enqueueAgent ( Agent* agentIn, QueueingWaypointPlanner* plannerIn )
+{
+    // determine agent ahead of the new agent
+    const Agent* aheadAgent = ( queueSlots.empty() ) ?nullptr:queueSlots.back().agent;
 
     // add agent to queue
-    queuedAgents.append ( agentIn );
+    QueueSlot slot;
+    slot.agent = agentIn;
+    slot.planner = plannerIn;
+    drawPrivateSpace ( slot.spacing, slot.heading );
+    slot.ahead = aheadAgent;
+    queueSlots.push_back ( slot );
 
     // inform about new first in line
     if ( aheadAgent == nullptr )
@@ -138,56 +201,47 @@ const Agent* WaitingQueue::enqueueAgent ( Agent* agentIn )
         emit queueLeaderChanged ( agentIn->getId() );
     }
 
-    // stay informed about updates on queue end
-    connect ( agentIn, SIGNAL ( positionChanged ( double,double ) ),
-              this, SLOT ( onLastAgentPositionChanged ( double,double ) ) );
-    // ignore updates from previous queue end
-    if ( aheadAgent != nullptr )
-    {
-        disconnect ( aheadAgent, SIGNAL ( positionChanged ( double,double ) ),
-                     this, SLOT ( onLastAgentPositionChanged ( double,double ) ) );
-    }
-
     // inform users
     emit queueEndChanged();
     informAboutEndPosition();
 
-    // return agent ahead of the new agent
-    return aheadAgent;
+    // return the initial queueing position
+    if ( aheadAgent == nullptr )
+        return position;
+    else
+        return aheadAgent->getPosition() - Ped::Tvector::fromPolar ( direction + slot.heading, slot.spacing );
 }
 
 bool WaitingQueue::dequeueAgent ( Agent* agentIn )
 {
     // sanity checks
-    if ( queuedAgents.isEmpty() )
+    if ( queueSlots.empty() )
     {
         ROS_DEBUG ( "Cannot dequeue agent from empty waiting queue!" );
         return false;
     }
 
     // remove agent from queue
-    bool dequeueSuccess;
-    bool dequeuedWasFirst = ( queuedAgents.first() == agentIn );
-    bool dequeuedWasLast = ( queuedAgents.last() == agentIn );
-    if ( dequeuedWasFirst )
+    auto it = std::find_if ( queueSlots.begin(), queueSlots.end(),
+                             [agentIn] ( const QueueSlot& slot )
+    {
+        return slot.agent == agentIn;
+    } );
+    if ( it == queueSlots.end() )
     {
-        queuedAgents.removeFirst();
-        dequeueSuccess = true;
+        ROS_DEBUG ( "Agent isn't waiting in queue! (Agent: %s, Queue: %s)",
+agentIn->toString().toStdString().c_str(), this->toString().toStdString().c_str() );
+        return false;
     }
-    else
+
+    bool dequeuedWasFirst = ( it == queueSlots.begin() );
+    bool dequeuedWasLast = ( it + 1 == queueSlots.end() );
+    if ( !dequeuedWasFirst )
     {
         ROS_DEBUG ( "Dequeueing agent from queue (%s), not in front of the queue",
 agentIn->toString().toStdString().c_str() );
-        int removedCount = queuedAgents.removeAll ( agentIn );
-        dequeueSuccess = ( removedCount >= 1 );
-
-        if ( dequeueSuccess == false )
-        {
-            ROS_DEBUG ( "Agent isn't waiting in queue! (Agent: %s, Queue: %s)",
-agentIn->toString().toStdString().c_str(), this->toString().toStdString().c_str() );
-            return false;
-        }
     }
+    queueSlots.erase ( it );
 
     // inform other agents
     emit agentDequeued ( agentIn->getId() );
@@ -196,7 +250,7 @@ agentIn->toString().toStdString().c_str(), this->toString().toStdString().c_str(
     if ( dequeuedWasFirst )
     {
         // determine new first agent in line
-        const Agent* newFront = ( queuedAgents.isEmpty() ) ? nullptr : queuedAgents.first();
+        const Agent* newFront = ( queueSlots.empty() ) ? nullptr : queueSlots.front().agent;
 
         // reset time for next agent
         resetDequeueTime();
@@ -209,32 +263,42 @@ agentIn->toString().toStdString().c_str(), this->toString().toStdString().c_str(
     // update queue end
     if ( dequeuedWasLast )
     {
-        disconnect ( agentIn, SIGNAL ( positionChanged ( double,double ) ),
-                     this, SLOT ( onLastAgentPositionChanged ( double,double ) ) );
-
         emit queueEndChanged();
         informAboutEndPosition();
     }
 
-    return dequeueSuccess;
+    return true;
 }
 
 bool WaitingQueue::hasReachedWaitingPosition()
 {
-    if ( queuedAgents.isEmpty() )
+    if ( queueSlots.empty() )
         return false;
 
     // const double waitingRadius = 0.7;
     const double waitingRadius = 0.3;
 
     // compute distance from where queue starts
-    const Agent* leadingAgent = queuedAgents.first();
+    const Agent* leadingAgent = queueSlots.front().agent;
     Ped::Tvector diff = leadingAgent->getPosition() - position;
     return ( diff.length() < waitingRadius );
 }
 
+/// Affects the behavior at the end of the queue and hence the shape
+void WaitingQueue::drawPrivateSpace ( double& distanceOut, Ped::Tangle& headingOut ) const
+{
+    std::uniform_real_distribution<double> spacing_range_ ( 0.2, 0.8 );
+    std::uniform_real_distribution<double> heading_range_ ( -45.0, 45.0 );
+
+    // randomize spacing and heading in queues
+    headingOut.setDegree ( heading_range_ ( RNG() ) );
+    distanceOut = spacing_range_ ( RNG() );
+}
+
 void WaitingQueue::resetDequeueTime()
 {
+    SCENE.cancelEvent ( dequeueEvent );
+    dequeueEvent = 0;
     dequeueTime = INFINITY;
 }
 
@@ -250,18 +314,20 @@ void WaitingQueue::startDequeueTime()
 
     double waitDuration = distribution ( RNG() );
     dequeueTime = SCENE.getTime() + waitDuration;
+
+    dequeueEvent = SCENE.scheduleEvent ( dequeueTime, [this]() { onDequeueTime(); } );
 }
 
 void WaitingQueue::informAboutEndPosition()
 {
     // inform users
-    if ( queuedAgents.isEmpty() )
+    if ( queueSlots.empty() )
     {
         emit queueEndPositionChanged ( position.x, position.y );
     }
     else
     {
-        Agent* lastAgent = queuedAgents.last();
+        Agent* lastAgent = queueSlots.back().agent;
         Ped::Tvector endPosition = lastAgent->getPosition();
         emit queueEndPositionChanged ( endPosition.x, endPosition.y );
     }
@@ -285,8 +351,8 @@ void WaitingQueue::setVisiblePosition ( const QPointF& positionIn )
 QString WaitingQueue::toString() const
 {
     QStringList waitingIDs;
-    foreach ( const Agent* agent, queuedAgents )
-        waitingIDs.append ( QString::number ( agent->getId() ) );
+    for ( const QueueSlot& slot : queueSlots )
+        waitingIDs.append ( QString::number ( slot.agent->getId() ) );
     QString waitingString = waitingIDs.join ( "," );
 
     return tr ( "WaitingQueue '%1' (@%2,%3; queue: %4)" )
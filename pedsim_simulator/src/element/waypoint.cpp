@@ -30,6 +30,8 @@
 */
 
 #include <pedsim_simulator/element/waypoint.h>
+#include <pedsim_simulator/scene.h>
+#include <pedsim/ped_agent.h>
 
 
 
@@ -86,3 +88,27 @@ void Waypoint::sety ( double yIn )
     // inform user
     emit positionChanged ( getx(), gety() );
 }
+
+Ped::Tvector Waypoint::getForce ( const Ped::Tagent& agent,
+                                  Ped::Tvector* desiredDirectionOut,
+                                  bool* reachedOut ) const
+{
+    // set default output parameters
+    if ( reachedOut != NULL )
+        *reachedOut = false;
+
+    Ped::Tvector agentPos = agent.getPosition();
+    Ped::Tvector destination = closestPoint ( agentPos, reachedOut );
+
+    // walk around obstacles in the way, if the scene routes agents
+    Ped::Tvector desiredDirection;
+    if ( !SCENE.getRoutedDirection ( agent.getId(), this, agentPos, destination, &desiredDirection ) )
+        desiredDirection = ( destination - agentPos ).normalized();
+
+    Ped::Tvector force = ( desiredDirection * agent.getVmax() - agent.getVelocity() ) / agent.getRelaxationTime();
+
+    if ( desiredDirectionOut != NULL )
+        *desiredDirectionOut = desiredDirection;
+
+    return force;
+}
@@ -0,0 +1,85 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/eventscheduler.h>
+
+EventScheduler::EventScheduler()
+    : next_id_(1)
+{
+}
+
+EventScheduler::~EventScheduler()
+{
+}
+
+EventScheduler::EventId EventScheduler::schedule(double timeIn, std::function<void()> callback)
+{
+    const EventId id = next_id_++;
+    queue_.push(Entry{ timeIn, id });
+    callbacks_[id] = std::move(callback);
+    return id;
+}
+
+void EventScheduler::cancel(EventId id)
+{
+    callbacks_.erase(id);
+
+    // don't let cancelled events pile up in the heap
+    if (callbacks_.empty())
+        queue_ = decltype(queue_)();
+}
+
+bool EventScheduler::isPending(EventId id) const
+{
+    return callbacks_.find(id) != callbacks_.end();
+}
+
+void EventScheduler::runUntil(double timeIn)
+{
+    while (!queue_.empty() && queue_.top().time <= timeIn) {
+        const EventId id = queue_.top().id;
+        queue_.pop();
+
+        auto it = callbacks_.find(id);
+        if (it == callbacks_.end())
+            continue; // cancelled
+
+        // the callback may schedule or cancel other events
+        std::function<void()> callback = std::move(it->second);
+        callbacks_.erase(it);
+        callback();
+    }
+}
+
+void EventScheduler::clear()
+{
+    queue_ = decltype(queue_)();
+    callbacks_.clear();
+}
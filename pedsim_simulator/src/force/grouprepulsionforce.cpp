@@ -33,6 +33,7 @@
 #include <pedsim_simulator/force/grouprepulsionforce.h>
 #include <pedsim_simulator/config.h>
 #include <pedsim_simulator/element/agent.h>
+#include <pedsim_simulator/scene.h>
 
 #include <ros/ros.h>
 
@@ -74,6 +75,29 @@ Ped::Tvector GroupRepulsionForce::getForce ( Ped::Tvector walkingDirection )
 
     // compute group repulsion force
     Ped::Tvector force;
+    const Ped::Tvector position = agent->getPosition();
+
+    // → member positions of this tick, contiguous in the scene's arrays
+    const Scene::GroupAggregate* aggregate = SCENE.getGroupAggregate ( group );
+    if ( aggregate != nullptr )
+    {
+        const std::vector<const Agent*>& members = SCENE.getGroupMembers();
+        const std::vector<Ped::Tvector>& positions = SCENE.getGroupMemberPositions();
+        const int end = aggregate->firstMember + aggregate->memberCount;
+        for ( int i = aggregate->firstMember; i < end; ++i )
+        {
+            if ( members[i] == agent )
+                continue;
+
+            Ped::Tvector diff = position - positions[i];
+            if ( diff.length() < overlapDistance )
+                force += diff;
+        }
+
+        force *= factor;
+        return force;
+    }
+
     // → iterate over all group members
     foreach ( Agent* currentAgent, group->getMembers() )
     {
@@ -0,0 +1,288 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/navigation/flowfield.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace {
+const int NEIGHBOR_X[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+const int NEIGHBOR_Y[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+const float NEIGHBOR_COST[8] = { 1, 1, 1, 1, M_SQRT2, M_SQRT2, M_SQRT2, M_SQRT2 };
+}
+
+FlowField::FlowField()
+{
+}
+
+FlowField::~FlowField()
+{
+}
+
+void FlowField::compute(const ObstacleMap& map, double goal_x, double goal_y, double goal_radius)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    const int width = map.getWidth();
+    const int height = map.getHeight();
+    const float resolution = map.getResolution();
+
+    distance_.assign(map.getNumCells(), infinity);
+    direction_.assign(2 * map.getNumCells(), 0.0f);
+
+    typedef std::pair<float, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > open;
+
+    // → the paths end in the cells within the goal, they point to its center
+    // (at least the cell of the goal itself, in case it's smaller than a cell)
+    const double radius = std::max(goal_radius, 0.0);
+    const int x0 = std::max(0, static_cast<int>(std::floor((goal_x - radius - map.getOriginX()) / resolution)));
+    const int x1 = std::min(width - 1, static_cast<int>(std::floor((goal_x + radius - map.getOriginX()) / resolution)));
+    const int y0 = std::max(0, static_cast<int>(std::floor((goal_y - radius - map.getOriginY()) / resolution)));
+    const int y1 = std::min(height - 1, static_cast<int>(std::floor((goal_y + radius - map.getOriginY()) / resolution)));
+    for (int iy = y0; iy <= y1; iy++) {
+        for (int ix = x0; ix <= x1; ix++) {
+            const double ox = goal_x - map.cellX(ix);
+            const double oy = goal_y - map.cellY(iy);
+            const double length = std::hypot(ox, oy);
+            if (length > radius)
+                continue;
+
+            const int cell = iy * width + ix;
+            distance_[cell] = 0;
+            if (length > 0) {
+                direction_[2 * cell] = ox / length;
+                direction_[2 * cell + 1] = oy / length;
+            }
+            open.push(QueueEntry(0, cell));
+        }
+    }
+    const int goal_cell = map.cellIndex(goal_x, goal_y);
+    if (goal_cell >= 0 && distance_[goal_cell] != 0) {
+        distance_[goal_cell] = 0;
+        open.push(QueueEntry(0, goal_cell));
+    }
+
+    // → path lengths over the free cells (fast marching, i.e. Dijkstra
+    // ordering with the update of the eikonal equation, which doesn't
+    // have the 45 degree bias of paths along the grid)
+    std::vector<uint8_t> accepted(map.getNumCells(), 0);
+    while (!open.empty()) {
+        const QueueEntry entry = open.top();
+        open.pop();
+
+        const int cell = entry.second;
+        if (accepted[cell])
+            continue; // outdated
+        accepted[cell] = 1;
+
+        const int ix = cell % width;
+        const int iy = cell / width;
+        for (int n = 0; n < 4; n++) {
+            const int nx = ix + NEIGHBOR_X[n];
+            const int ny = iy + NEIGHBOR_Y[n];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                continue;
+
+            const int neighbor = ny * width + nx;
+            if (accepted[neighbor] || map.isBlocked(neighbor))
+                continue;
+
+            // smallest accepted values along both axes
+            float a = infinity, b = infinity;
+            if (nx > 0 && accepted[neighbor - 1])
+                a = distance_[neighbor - 1];
+            if (nx < width - 1 && accepted[neighbor + 1])
+                a = std::min(a, distance_[neighbor + 1]);
+            if (ny > 0 && accepted[neighbor - width])
+                b = distance_[neighbor - width];
+            if (ny < height - 1 && accepted[neighbor + width])
+                b = std::min(b, distance_[neighbor + width]);
+            if (a > b)
+                std::swap(a, b);
+
+            float distance;
+            if (b - a >= resolution)
+                distance = a + resolution;
+            else
+                distance = 0.5f * (a + b + std::sqrt(2 * resolution * resolution - (b - a) * (b - a)));
+
+            if (distance < distance_[neighbor]) {
+                distance_[neighbor] = distance;
+                open.push(QueueEntry(distance, neighbor));
+            }
+        }
+    }
+
+    // → walking directions, downhill along both axes
+    for (int iy = 0; iy < height; iy++) {
+        for (int ix = 0; ix < width; ix++) {
+            const int cell = iy * width + ix;
+            if (map.isBlocked(cell) || distance_[cell] == 0 || std::isinf(distance_[cell]))
+                continue;
+
+            const float d = distance_[cell];
+            const float left = (ix > 0) ? distance_[cell - 1] : infinity;
+            const float right = (ix < width - 1) ? distance_[cell + 1] : infinity;
+            const float down = (iy > 0) ? distance_[cell - width] : infinity;
+            const float up = (iy < height - 1) ? distance_[cell + width] : infinity;
+
+            // (on ties, e.g. where two paths split up, pick one side)
+            float gx = 0, gy = 0;
+            if (left <= right && left < d)
+                gx = left - d;
+            else if (right < d)
+                gx = d - right;
+            if (down <= up && down < d)
+                gy = down - d;
+            else if (up < d)
+                gy = d - up;
+
+            const float length = std::sqrt(gx * gx + gy * gy);
+            if (length > 0) {
+                direction_[2 * cell] = gx / length;
+                direction_[2 * cell + 1] = gy / length;
+            }
+        }
+    }
+
+    // → blocked cells next to free ones point back into the free space
+    // (blocked cells are never used as neighbours, so their distances
+    // can be set right away)
+    for (int iy = 0; iy < height; iy++) {
+        for (int ix = 0; ix < width; ix++) {
+            const int cell = iy * width + ix;
+            if (!map.isBlocked(cell) || distance_[cell] == 0)
+                continue;
+
+            float best = infinity;
+            int best_n = -1;
+            for (int n = 0; n < 8; n++) {
+                const int nx = ix + NEIGHBOR_X[n];
+                const int ny = iy + NEIGHBOR_Y[n];
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                    continue;
+
+                const int neighbor = ny * width + nx;
+                if (map.isBlocked(neighbor))
+                    continue;
+
+                const float distance = distance_[neighbor] + NEIGHBOR_COST[n] * resolution;
+                if (distance < best) {
+                    best = distance;
+                    best_n = n;
+                }
+            }
+            if (best_n < 0)
+                continue;
+
+            const float norm = 1.0f / NEIGHBOR_COST[best_n];
+            direction_[2 * cell] = NEIGHBOR_X[best_n] * norm;
+            direction_[2 * cell + 1] = NEIGHBOR_Y[best_n] * norm;
+            distance_[cell] = best;
+        }
+    }
+}
+
+bool FlowField::lookup(const ObstacleMap& map, double x, double y,
+    double& dx, double& dy, double& distance) const
+{
+    if (distance_.empty() || map.cellIndex(x, y) < 0)
+        return false;
+
+    // between the centers of the four closest cells
+    const double fx = (x - map.getOriginX()) / map.getResolution() - 0.5;
+    const double fy = (y - map.getOriginY()) / map.getResolution() - 0.5;
+    const int ix = static_cast<int>(std::floor(fx));
+    const int iy = static_cast<int>(std::floor(fy));
+    const double tx = fx - ix;
+    const double ty = fy - iy;
+
+    double sum_weight = 0;
+    double sum_dx = 0, sum_dy = 0, sum_distance = 0;
+    int num_corners = 0;
+    int corner_cells[4];
+    double best_weight = -1;
+    int best_cell = -1;
+    for (int corner = 0; corner < 4; corner++) {
+        const int cx = ix + (corner & 1);
+        const int cy = iy + (corner >> 1);
+        if (cx < 0 || cy < 0 || cx >= map.getWidth() || cy >= map.getHeight())
+            continue;
+
+        const int cell = cy * map.getWidth() + cx;
+        if (std::isinf(distance_[cell]))
+            continue;
+
+        const double weight = ((corner & 1) ? tx : 1 - tx) * ((corner >> 1) ? ty : 1 - ty);
+        sum_weight += weight;
+        sum_dx += weight * direction_[2 * cell];
+        sum_dy += weight * direction_[2 * cell + 1];
+        sum_distance += weight * distance_[cell];
+
+        corner_cells[num_corners++] = cell;
+        if (weight > best_weight) {
+            best_weight = weight;
+            best_cell = cell;
+        }
+    }
+    if (sum_weight <= 0)
+        return false;
+
+    distance = sum_distance / sum_weight;
+
+    // where two equally long paths split up, the corners point to
+    // opposite sides and their blend can point into the obstacle
+    // between them, take the direction of the closest corner there
+    bool split = false;
+    for (int i = 0; i < num_corners && !split; i++) {
+        for (int j = i + 1; j < num_corners && !split; j++) {
+            const int a = corner_cells[i], b = corner_cells[j];
+            split = direction_[2 * a] * direction_[2 * b] + direction_[2 * a + 1] * direction_[2 * b + 1] < 0;
+        }
+    }
+    if (split) {
+        sum_dx = direction_[2 * best_cell];
+        sum_dy = direction_[2 * best_cell + 1];
+    }
+
+    const double length = std::hypot(sum_dx, sum_dy);
+    if (length == 0)
+        return false;
+
+    dx = sum_dx / length;
+    dy = sum_dy / length;
+    return true;
+}
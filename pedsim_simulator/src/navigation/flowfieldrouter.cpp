@@ -0,0 +1,104 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/navigation/flowfieldrouter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// free space around the walls and goals included in the raster
+const double MAP_MARGIN = 2.0;
+// path lengths from fast marching are up to ~5% longer than the
+// straight line in the open (along the diagonals)
+const double DETOUR_RATIO = 1.06;
+}
+
+FlowFieldRouter::FlowFieldRouter(double resolution, double clearance)
+    : resolution_(resolution)
+    , clearance_(clearance)
+{
+}
+
+FlowFieldRouter::~FlowFieldRouter()
+{
+}
+
+void FlowFieldRouter::build(const std::vector<Segment>& walls, const std::vector<Goal>& goals)
+{
+    fields_.clear();
+    if (walls.empty() && goals.empty())
+        return;
+
+    // → extents of the scenario
+    double min_x = std::numeric_limits<double>::max();
+    double min_y = min_x;
+    double max_x = std::numeric_limits<double>::lowest();
+    double max_y = max_x;
+    for (const Segment& wall : walls) {
+        min_x = std::min(min_x, std::min(wall.ax, wall.bx));
+        min_y = std::min(min_y, std::min(wall.ay, wall.by));
+        max_x = std::max(max_x, std::max(wall.ax, wall.bx));
+        max_y = std::max(max_y, std::max(wall.ay, wall.by));
+    }
+    for (const Goal& goal : goals) {
+        min_x = std::min(min_x, goal.x - goal.radius);
+        min_y = std::min(min_y, goal.y - goal.radius);
+        max_x = std::max(max_x, goal.x + goal.radius);
+        max_y = std::max(max_y, goal.y + goal.radius);
+    }
+
+    map_.build(walls, min_x - MAP_MARGIN, min_y - MAP_MARGIN,
+        max_x + MAP_MARGIN, max_y + MAP_MARGIN, resolution_, clearance_);
+
+    // → one field per goal, shared by all agents heading there
+    for (const Goal& goal : goals)
+        fields_[goal.id].compute(map_, goal.x, goal.y, goal.radius);
+}
+
+bool FlowFieldRouter::getDirection(int agent, int goal, double x, double y, double target_x, double target_y,
+    double& dx, double& dy)
+{
+    auto it = fields_.find(goal);
+    if (it == fields_.end())
+        return false;
+
+    double distance;
+    if (!it->second.lookup(map_, x, y, dx, dy, distance))
+        return false;
+
+    // keep walking straight when nothing is in the way
+    double target_dx, target_dy, target_distance;
+    if (!it->second.lookup(map_, target_x, target_y, target_dx, target_dy, target_distance))
+        target_distance = 0;
+    const double straight = std::hypot(target_x - x, target_y - y);
+    return (distance > target_distance + DETOUR_RATIO * straight + resolution_);
+}
@@ -0,0 +1,96 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/navigation/obstaclemap.h>
+
+#include <algorithm>
+#include <cmath>
+
+ObstacleMap::ObstacleMap()
+    : origin_x_(0)
+    , origin_y_(0)
+    , resolution_(1.0)
+    , width_(0)
+    , height_(0)
+{
+}
+
+ObstacleMap::~ObstacleMap()
+{
+}
+
+void ObstacleMap::build(const std::vector<Router::Segment>& walls, double min_x, double min_y,
+    double max_x, double max_y, double resolution, double clearance)
+{
+    resolution_ = resolution;
+    origin_x_ = min_x;
+    origin_y_ = min_y;
+    width_ = std::max(1, static_cast<int>(std::ceil((max_x - min_x) / resolution)));
+    height_ = std::max(1, static_cast<int>(std::ceil((max_y - min_y) / resolution)));
+    blocked_.assign(width_ * height_, 0);
+
+    // only visit the cells around each wall
+    const double clearance_sq = clearance * clearance;
+    for (const Router::Segment& wall : walls) {
+        const double ux = wall.bx - wall.ax;
+        const double uy = wall.by - wall.ay;
+        const double length_sq = ux * ux + uy * uy;
+
+        const int x0 = std::max(0, static_cast<int>(std::floor((std::min(wall.ax, wall.bx) - clearance - origin_x_) / resolution_)));
+        const int x1 = std::min(width_ - 1, static_cast<int>(std::floor((std::max(wall.ax, wall.bx) + clearance - origin_x_) / resolution_)));
+        const int y0 = std::max(0, static_cast<int>(std::floor((std::min(wall.ay, wall.by) - clearance - origin_y_) / resolution_)));
+        const int y1 = std::min(height_ - 1, static_cast<int>(std::floor((std::max(wall.ay, wall.by) + clearance - origin_y_) / resolution_)));
+
+        for (int iy = y0; iy <= y1; iy++) {
+            for (int ix = x0; ix <= x1; ix++) {
+                const double px = cellX(ix) - wall.ax;
+                const double py = cellY(iy) - wall.ay;
+
+                // distance from the cell center to the closest point on the wall
+                double t = (length_sq > 0) ? (px * ux + py * uy) / length_sq : 0;
+                t = std::max(0.0, std::min(1.0, t));
+                const double dx = px - t * ux;
+                const double dy = py - t * uy;
+
+                if (dx * dx + dy * dy <= clearance_sq)
+                    blocked_[iy * width_ + ix] = 1;
+            }
+        }
+    }
+}
+
+int ObstacleMap::cellIndex(double x, double y) const
+{
+    const int ix = static_cast<int>(std::floor((x - origin_x_) / resolution_));
+    const int iy = static_cast<int>(std::floor((y - origin_y_) / resolution_));
+    if (ix < 0 || iy < 0 || ix >= width_ || iy >= height_)
+        return -1;
+    return iy * width_ + ix;
+}
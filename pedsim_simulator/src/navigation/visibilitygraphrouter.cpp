@@ -0,0 +1,421 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/navigation/visibilitygraphrouter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace {
+// cells of the wall grid (meters)
+const double CELL_SIZE = 2.0;
+
+double pointSegmentDistance(double px, double py, double ax, double ay, double bx, double by)
+{
+    const double ux = bx - ax, uy = by - ay;
+    const double length_sq = ux * ux + uy * uy;
+    double t = (length_sq > 0) ? ((px - ax) * ux + (py - ay) * uy) / length_sq : 0;
+    t = std::max(0.0, std::min(1.0, t));
+    return std::hypot(px - ax - t * ux, py - ay - t * uy);
+}
+
+double cross(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+double segmentDistance(double ax, double ay, double bx, double by, const Router::Segment& wall)
+{
+    // → crossing
+    const double d1 = cross(ax, ay, bx, by, wall.ax, wall.ay);
+    const double d2 = cross(ax, ay, bx, by, wall.bx, wall.by);
+    const double d3 = cross(wall.ax, wall.ay, wall.bx, wall.by, ax, ay);
+    const double d4 = cross(wall.ax, wall.ay, wall.bx, wall.by, bx, by);
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        return 0;
+
+    // → otherwise one of the end points is closest
+    return std::min(
+        std::min(pointSegmentDistance(ax, ay, wall.ax, wall.ay, wall.bx, wall.by),
+            pointSegmentDistance(bx, by, wall.ax, wall.ay, wall.bx, wall.by)),
+        std::min(pointSegmentDistance(wall.ax, wall.ay, ax, ay, bx, by),
+            pointSegmentDistance(wall.bx, wall.by, ax, ay, bx, by)));
+}
+}
+
+VisibilityGraphRouter::VisibilityGraphRouter(double clearance, double corridor_width, size_t cache_size)
+    : clearance_(clearance)
+    , corridor_width_(corridor_width)
+    , cache_size_(std::max<size_t>(1, cache_size))
+    , stamp_(0)
+{
+}
+
+VisibilityGraphRouter::~VisibilityGraphRouter()
+{
+}
+
+void VisibilityGraphRouter::build(const std::vector<Segment>& walls, const std::vector<Goal>& goals)
+{
+    walls_ = walls;
+    wall_stamps_.assign(walls_.size(), 0);
+    stamp_ = 0;
+    nodes_.clear();
+    goals_.clear();
+    table_order_.clear();
+    tables_.clear();
+    routes_.clear();
+
+    for (const Goal& goal : goals)
+        goals_[goal.id] = goal;
+
+    // → grid of the walls, each in the cells within the clearance of it
+    double min_x = std::numeric_limits<double>::max(), min_y = min_x;
+    double max_x = std::numeric_limits<double>::lowest(), max_y = max_x;
+    for (const Segment& wall : walls_) {
+        min_x = std::min(min_x, std::min(wall.ax, wall.bx));
+        min_y = std::min(min_y, std::min(wall.ay, wall.by));
+        max_x = std::max(max_x, std::max(wall.ax, wall.bx));
+        max_y = std::max(max_y, std::max(wall.ay, wall.by));
+    }
+    if (walls_.empty()) {
+        wall_grid_ = UniformGrid();
+        return;
+    }
+    wall_grid_.reset(min_x - CELL_SIZE, min_y - CELL_SIZE, max_x + CELL_SIZE, max_y + CELL_SIZE, CELL_SIZE);
+    for (size_t i = 0; i < walls_.size(); i++) {
+        const Segment& wall = walls_[i];
+        wall_grid_.insertBox(i, std::min(wall.ax, wall.bx) - clearance_, std::min(wall.ay, wall.by) - clearance_,
+            std::max(wall.ax, wall.bx) + clearance_, std::max(wall.ay, wall.by) + clearance_);
+    }
+
+    // → directions of the walls meeting at each end point
+    std::map<std::pair<long, long>, std::pair<std::pair<double, double>, std::vector<double> > > corners;
+    for (const Segment& wall : walls_) {
+        const double length = std::hypot(wall.bx - wall.ax, wall.by - wall.ay);
+        if (length <= 0)
+            continue;
+
+        auto& a = corners[std::make_pair(std::lround(wall.ax * 1000), std::lround(wall.ay * 1000))];
+        a.first = std::make_pair(wall.ax, wall.ay);
+        a.second.push_back(std::atan2(wall.by - wall.ay, wall.bx - wall.ax));
+        auto& b = corners[std::make_pair(std::lround(wall.bx * 1000), std::lround(wall.by * 1000))];
+        b.first = std::make_pair(wall.bx, wall.by);
+        b.second.push_back(std::atan2(wall.ay - wall.by, wall.ax - wall.bx));
+    }
+    for (auto& corner : corners)
+        addCornerNodes(corner.second.first.first, corner.second.first.second, corner.second.second);
+
+    // → edges between the nodes that see each other
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        for (size_t j = i + 1; j < nodes_.size(); j++) {
+            if (!isVisible(nodes_[i].x, nodes_[i].y, nodes_[j].x, nodes_[j].y))
+                continue;
+
+            const float cost = std::hypot(nodes_[j].x - nodes_[i].x, nodes_[j].y - nodes_[i].y);
+            nodes_[i].neighbors.push_back(j);
+            nodes_[i].costs.push_back(cost);
+            nodes_[j].neighbors.push_back(i);
+            nodes_[j].costs.push_back(cost);
+        }
+    }
+}
+
+void VisibilityGraphRouter::addCornerNodes(double x, double y, std::vector<double>& angles)
+{
+    // nodes go into the gaps between the walls wider than 180 degrees,
+    // where the corner sticks out (two for free wall ends)
+    const double distance = clearance_ * M_SQRT2;
+    std::sort(angles.begin(), angles.end());
+    for (size_t i = 0; i < angles.size(); i++) {
+        const double from = angles[i];
+        const double gap = (i + 1 < angles.size()) ? angles[i + 1] - from : angles[0] + 2 * M_PI - from;
+        if (gap <= M_PI + 1e-6)
+            continue;
+
+        const int count = (gap > 1.5 * M_PI) ? 2 : 1;
+        for (int k = 1; k <= count; k++) {
+            const double angle = from + gap * k / (count + 1);
+            const double nx = x + distance * std::cos(angle);
+            const double ny = y + distance * std::sin(angle);
+            if (!isFree(nx, ny))
+                continue;
+
+            Node node;
+            node.x = nx;
+            node.y = ny;
+            nodes_.push_back(node);
+        }
+    }
+}
+
+bool VisibilityGraphRouter::isFree(double x, double y)
+{
+    // all walls within the clearance are in the cell of the point
+    bool free = true;
+    wall_grid_.traverse(x, y, 1, 0, 0, [&](int cell, double) {
+        for (const int item : wall_grid_.items(cell)) {
+            const Segment& wall = walls_[item];
+            if (pointSegmentDistance(x, y, wall.ax, wall.ay, wall.bx, wall.by) < 0.9 * clearance_) {
+                free = false;
+                return true;
+            }
+        }
+        return true;
+    });
+    return free;
+}
+
+bool VisibilityGraphRouter::isVisible(double ax, double ay, double bx, double by)
+{
+    const double length = std::hypot(bx - ax, by - ay);
+    if (length <= 0 || walls_.empty())
+        return true;
+
+    // walls span several cells, test each once
+    if (++stamp_ == 0) {
+        std::fill(wall_stamps_.begin(), wall_stamps_.end(), 0);
+        stamp_ = 1;
+    }
+
+    // lines may pass closer to the walls than the nodes are placed
+    const double margin = 0.5 * clearance_;
+    bool visible = true;
+    wall_grid_.traverse(ax, ay, (bx - ax) / length, (by - ay) / length, length, [&](int cell, double) {
+        for (const int item : wall_grid_.items(cell)) {
+            if (wall_stamps_[item] == stamp_)
+                continue;
+            wall_stamps_[item] = stamp_;
+
+            if (segmentDistance(ax, ay, bx, by, walls_[item]) < margin) {
+                visible = false;
+                return true;
+            }
+        }
+        return false;
+    });
+    return visible;
+}
+
+const VisibilityGraphRouter::PathTable* VisibilityGraphRouter::getPathTable(int goal)
+{
+    // → recently used
+    auto cached = tables_.find(goal);
+    if (cached != tables_.end()) {
+        table_order_.splice(table_order_.begin(), table_order_, cached->second.second);
+        return &cached->second.first;
+    }
+
+    auto goal_it = goals_.find(goal);
+    if (goal_it == goals_.end())
+        return nullptr;
+    const Goal& target = goal_it->second;
+
+    // → shortest paths from all nodes, starting at the ones seeing the goal
+    PathTable table;
+    table.distance.assign(nodes_.size(), std::numeric_limits<float>::infinity());
+    table.next.assign(nodes_.size(), UNREACHABLE);
+
+    typedef std::pair<float, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > open;
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        if (!isVisible(nodes_[i].x, nodes_[i].y, target.x, target.y))
+            continue;
+
+        table.distance[i] = std::hypot(target.x - nodes_[i].x, target.y - nodes_[i].y);
+        table.next[i] = GOAL;
+        open.push(QueueEntry(table.distance[i], i));
+    }
+    while (!open.empty()) {
+        const QueueEntry entry = open.top();
+        open.pop();
+
+        const int node = entry.second;
+        if (entry.first > table.distance[node])
+            continue; // outdated
+
+        const Node& current = nodes_[node];
+        for (size_t n = 0; n < current.neighbors.size(); n++) {
+            const int neighbor = current.neighbors[n];
+            const float distance = table.distance[node] + current.costs[n];
+            if (distance < table.distance[neighbor]) {
+                table.distance[neighbor] = distance;
+                table.next[neighbor] = node;
+                open.push(QueueEntry(distance, neighbor));
+            }
+        }
+    }
+
+    // → drop the least recently used one
+    if (tables_.size() >= cache_size_) {
+        tables_.erase(table_order_.back());
+        table_order_.pop_back();
+    }
+    table_order_.push_front(goal);
+    auto inserted = tables_.insert(std::make_pair(goal, std::make_pair(std::move(table), table_order_.begin())));
+    return &inserted.first->second.first;
+}
+
+bool VisibilityGraphRouter::plan(Route& route, int goal, double x, double y, double target_x, double target_y)
+{
+    route.goal = goal;
+    route.from_x = x;
+    route.from_y = y;
+
+    // → nothing in the way
+    if (isVisible(x, y, target_x, target_y)) {
+        route.node = GOAL;
+        route.to_x = target_x;
+        route.to_y = target_y;
+        return true;
+    }
+
+    const PathTable* table = getPathTable(goal);
+    if (table == nullptr)
+        return false;
+
+    // → the first corner, the closest one to the goal in sight
+    std::vector<std::pair<float, int> > candidates;
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        if (table->next[i] == UNREACHABLE)
+            continue;
+        candidates.push_back(std::make_pair(table->distance[i] + std::hypot(nodes_[i].x - x, nodes_[i].y - y), i));
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto& candidate : candidates) {
+        const Node& node = nodes_[candidate.second];
+        if (!isVisible(x, y, node.x, node.y))
+            continue;
+
+        route.node = candidate.second;
+        route.to_x = node.x;
+        route.to_y = node.y;
+        return true;
+    }
+
+    return false;
+}
+
+void VisibilityGraphRouter::pullString(Route& route, const PathTable& table,
+    double x, double y, double target_x, double target_y, bool at_corner)
+{
+    // → as far along the path as the agent can see, at the corner itself
+    // the next one is in sight anyway (there is an edge to it)
+    int node = route.node;
+    while (true) {
+        const int next = table.next[node];
+        const bool forced = at_corner && (node == route.node);
+        if (next == GOAL) {
+            if (forced || isVisible(x, y, target_x, target_y)) {
+                route.node = GOAL;
+                route.from_x = x;
+                route.from_y = y;
+                route.to_x = target_x;
+                route.to_y = target_y;
+                return;
+            }
+            break;
+        }
+        if (next == UNREACHABLE || (!forced && !isVisible(x, y, nodes_[next].x, nodes_[next].y)))
+            break;
+
+        node = next;
+    }
+
+    if (node == route.node)
+        return; // → keep walking towards the corner
+
+    route.node = node;
+    route.from_x = x;
+    route.from_y = y;
+    route.to_x = nodes_[node].x;
+    route.to_y = nodes_[node].y;
+}
+
+bool VisibilityGraphRouter::getDirection(int agent, int goal, double x, double y, double target_x, double target_y,
+    double& dx, double& dy)
+{
+    if (goals_.find(goal) == goals_.end())
+        return false;
+
+    auto it = routes_.find(agent);
+    bool replan = (it == routes_.end()) || (it->second.goal != goal);
+    Route& route = routes_[agent];
+
+    if (!replan) {
+        // → left the corridor around the current leg
+        if (pointSegmentDistance(x, y, route.from_x, route.from_y, route.to_x, route.to_y) > corridor_width_)
+            replan = true;
+        // → the target moved away (e.g. the end of a queue)
+        else if (route.node == GOAL && std::hypot(target_x - route.to_x, target_y - route.to_y) > corridor_width_)
+            replan = true;
+    }
+    if (replan && !plan(route, goal, x, y, target_x, target_y)) {
+        routes_.erase(agent);
+        return false;
+    }
+
+    if (route.node == GOAL)
+        return false;
+
+    // → close to the corner, look ahead
+    const double leg_x = route.to_x - route.from_x;
+    const double leg_y = route.to_y - route.from_y;
+    const double leg_sq = leg_x * leg_x + leg_y * leg_y;
+    const bool passed = (leg_sq > 0) && ((x - route.from_x) * leg_x + (y - route.from_y) * leg_y >= leg_sq);
+    const double corner_distance = std::hypot(route.to_x - x, route.to_y - y);
+    if (passed || corner_distance < 0.5 * corridor_width_) {
+        const PathTable* table = getPathTable(goal);
+        if (table == nullptr)
+            return false;
+
+        pullString(route, *table, x, y, target_x, target_y, passed || corner_distance < clearance_);
+        if (route.node == GOAL)
+            return false;
+    }
+
+    const double length = std::hypot(route.to_x - x, route.to_y - y);
+    if (length <= 0)
+        return false;
+
+    dx = (route.to_x - x) / length;
+    dy = (route.to_y - y) / length;
+    return true;
+}
+
+void VisibilityGraphRouter::forgetAgent(int agent)
+{
+    routes_.erase(agent);
+}
@@ -0,0 +1,135 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/realtime.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace realtime {
+
+bool setFifoPriority(int priority, std::string& error)
+{
+#ifdef __linux__
+    sched_param param;
+    param.sched_priority = std::min(std::max(priority, sched_get_priority_min(SCHED_FIFO)),
+        sched_get_priority_max(SCHED_FIFO));
+    const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0) {
+        error = std::strerror(result);
+        return false;
+    }
+    return true;
+#else
+    error = "not supported on this platform";
+    return false;
+#endif
+}
+
+bool setCpuAffinity(const std::vector<int>& cpus, std::string& error)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        error = std::strerror(result);
+        return false;
+    }
+    return true;
+#else
+    error = "not supported on this platform";
+    return false;
+#endif
+}
+
+bool lockMemory(std::string& error)
+{
+#ifdef __linux__
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    error = "not supported on this platform";
+    return false;
+#endif
+}
+
+TickStatistics::TickStatistics()
+{
+    reset();
+}
+
+void TickStatistics::reset()
+{
+    ticks_ = 0;
+    overruns_ = 0;
+    duration_sum_ = 0.0;
+    max_duration_ = 0.0;
+    last_duration_ = 0.0;
+    max_lateness_ = 0.0;
+}
+
+void TickStatistics::addTick(double duration, double lateness)
+{
+    ticks_++;
+    duration_sum_ += duration;
+    max_duration_ = std::max(max_duration_, duration);
+    last_duration_ = duration;
+    if (lateness > 0) {
+        overruns_++;
+        max_lateness_ = std::max(max_lateness_, lateness);
+    }
+}
+
+std::string TickStatistics::toString() const
+{
+    std::ostringstream stream;
+    stream << ticks_ << " ticks, " << overruns_ << " overruns, duration mean "
+           << getMeanDuration() * 1000.0 << " ms, max " << max_duration_ * 1000.0
+           << " ms, max lateness " << max_lateness_ * 1000.0 << " ms";
+    return stream.str();
+}
+
+} // namespace realtime
@@ -0,0 +1,96 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/robotkinematics.h>
+
+#include <cmath>
+
+RobotKinematics::RobotKinematics(Model model, double x, double y, double theta)
+    : model_(model)
+    , x_(x)
+    , y_(y)
+    , theta_(theta)
+    , vx_(0)
+    , vy_(0)
+    , omega_(0)
+    , world_vx_(0)
+    , world_vy_(0)
+    , max_speed_(0)
+{
+}
+
+RobotKinematics::~RobotKinematics() {}
+
+void RobotKinematics::setCommand(double vx, double vy, double omega)
+{
+    vx_ = vx;
+    vy_ = (model_ == HOLONOMIC) ? vy : 0.0; // a diff drive cannot move sideways
+    omega_ = omega;
+
+    const double speed = std::hypot(vx_, vy_);
+    if (max_speed_ > 0 && speed > max_speed_) {
+        vx_ *= max_speed_ / speed;
+        vy_ *= max_speed_ / speed;
+    }
+}
+
+void RobotKinematics::setMaxSpeed(double max_speed)
+{
+    max_speed_ = max_speed;
+}
+
+void RobotKinematics::setPose(double x, double y, double theta)
+{
+    x_ = x;
+    y_ = y;
+    theta_ = theta;
+}
+
+void RobotKinematics::integrate(double dt)
+{
+    if (dt <= 0)
+        return;
+
+    // → exact for constant commands: the robot drives on a circular arc,
+    // integrate with the heading in the middle of the step
+    const double theta_mid = theta_ + 0.5 * omega_ * dt;
+    const double c = std::cos(theta_mid), s = std::sin(theta_mid);
+
+    // chord length of the arc relative to the arc length
+    const double half_angle = 0.5 * omega_ * dt;
+    const double chord = std::fabs(half_angle) > 1e-9 ? std::sin(half_angle) / half_angle : 1.0;
+
+    world_vx_ = chord * (c * vx_ - s * vy_);
+    world_vy_ = chord * (s * vx_ + c * vy_);
+
+    x_ += world_vx_ * dt;
+    y_ += world_vy_ * dt;
+    theta_ = std::atan2(std::sin(theta_ + omega_ * dt), std::cos(theta_ + omega_ * dt));
+}
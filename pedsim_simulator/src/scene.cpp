@@ -34,6 +34,7 @@
 
 #include <pedsim_simulator/element/agent.h>
 #include <pedsim_simulator/element/agentcluster.h>
+#include <pedsim_simulator/element/agentgroup.h>
 #include <pedsim_simulator/element/obstacle.h>
 #include <pedsim_simulator/element/areawaypoint.h>
 #include <pedsim_simulator/element/waitingqueue.h>
@@ -43,11 +44,14 @@
 #include <pedsim_simulator/force/grouprepulsionforce.h>
 #include <pedsim_simulator/force/randomforce.h>
 #include <pedsim_simulator/force/alongwallforce.h>
+#include <pedsim_simulator/navigation/router.h>
 #include <pedsim/ped_tree.h>
 #include <QGraphicsScene>
 
 #include <ros/ros.h>
 
+#include <algorithm>
+
 // initialize static value
 Scene* Scene::Scene::instance = nullptr;
 
@@ -63,12 +67,23 @@ Scene::Scene(QObject* parent)
     tree = new Ped::Ttree(this, 0, area.x(), area.y(), area.width(), area.height());
 
     obstacle_cells_.clear();
+    obstacle_cell_keys_.clear();
+    obstacle_cells_revision_ = 0;
+
+    groupAggregatesValid = false;
+
+    attractionIndexRadius = 0;
+    attractionIndexValid = false;
+
+    router = nullptr;
+    routerRevision = -1;
 }
 
 Scene::~Scene()
 {
     // clean up
     clear();
+    delete router;
 }
 
 Scene& Scene::getInstance()
@@ -87,19 +102,25 @@ void Scene::clear()
     // remove all agents
     // note: we don't need to delete them, because Ped::Tscene did so already
     agents.clear();
+    agentsById.clear();
 
     // remove all waypoints
     // note: we don't need to delete them, because Ped::Tscene did so already
     waypoints.clear();
+    waitingQueues.clear();
 
     // remove all obstacles
     // note: we don't need to delete them, because Ped::Tscene did so already
     obstacles.clear();
+    obstacle_cells_.clear();
+    obstacle_cell_keys_.clear();
+    obstacle_cells_revision_++;
 
     // remove all agents groups
     foreach (AttractionArea* attraction, attractions)
         delete attraction;
     attractions.clear();
+    attractionIndexValid = false;
 
     // remove all agents clusters
     foreach (AgentCluster* agentCluster, agentClusters)
@@ -110,9 +131,13 @@ void Scene::clear()
     foreach (AgentGroup* group, agentGroups)
         delete group;
     agentGroups.clear();
+    groupAggregatesValid = false;
 
     // don't clear the grid, because we can reuse it
 
+    // the owners of pending events are gone
+    events.clear();
+
     // reset time
     sceneTime = 0;
     emit sceneTimeChanged(sceneTime);
@@ -190,12 +215,7 @@ QMap<QString, AttractionArea*> Scene::getAttractions()
 
 Agent* Scene::getAgentById(int idIn) const
 {
-    foreach (Agent* currentAgent, agents) {
-        if (idIn == currentAgent->getId())
-            return currentAgent;
-    }
-
-    return nullptr;
+    return agentsById.value(idIn, nullptr);
 }
 
 const QList<Obstacle*>& Scene::getObstacles() const
@@ -265,6 +285,76 @@ AttractionArea* Scene::getClosestAttraction(const Ped::Tvector& positionIn, doub
     return minArg;
 }
 
+AttractionArea* Scene::getClosestAttractionWithin(const Ped::Tvector& positionIn, double maxDistance, double* distanceOut)
+{
+    if (!attractionIndexValid || maxDistance > attractionIndexRadius)
+        buildAttractionIndex(maxDistance);
+
+    double minDistance = INFINITY;
+    AttractionArea* minArg = nullptr;
+
+    // only the attractions reaching into the cell are candidates,
+    // outside of any influence zone there are none
+    const int cell = attractionGrid.empty() ? -1 : attractionGrid.cellIndex(positionIn.x, positionIn.y);
+    if (cell >= 0) {
+        for (const int item : attractionGrid.items(cell)) {
+            AttractionArea* attraction = attractionItems[item];
+            double distance = (attraction->getPosition() - positionIn).length();
+            if (distance < minDistance && distance < maxDistance) {
+                minDistance = distance;
+                minArg = attraction;
+            }
+        }
+    }
+
+    // additionally return distance
+    if (distanceOut != nullptr)
+        *distanceOut = minDistance;
+
+    return minArg;
+}
+
+void Scene::buildAttractionIndex(double radius)
+{
+    attractionGrid = UniformGrid();
+    attractionItems.clear();
+    attractionIndexRadius = radius;
+    attractionIndexValid = true;
+
+    if (attractions.isEmpty())
+        return;
+
+    // bounding box of all influence zones
+    double minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    foreach (AttractionArea* attraction, attractions) {
+        const Ped::Tvector position = attraction->getPosition();
+        minX = std::min(minX, position.x - radius);
+        minY = std::min(minY, position.y - radius);
+        maxX = std::max(maxX, position.x + radius);
+        maxY = std::max(maxY, position.y + radius);
+    }
+
+    // → 1 m cells, coarser for very large scenes
+    double cellSize = 1.0;
+    while ((maxX - minX) * (maxY - minY) / (cellSize * cellSize) > 4e6)
+        cellSize *= 2;
+    attractionGrid.reset(minX, minY, maxX + cellSize, maxY + cellSize, cellSize);
+
+    // add every attraction to the cells around its influence circle, the
+    // queries only accept attractions within the distance
+    foreach (AttractionArea* attraction, attractions) {
+        const Ped::Tvector position = attraction->getPosition();
+        attractionGrid.insertBox(static_cast<int>(attractionItems.size()),
+            position.x - radius, position.y - radius, position.x + radius, position.y + radius);
+        attractionItems.push_back(attraction);
+    }
+}
+
+void Scene::invalidateAttractionIndex()
+{
+    attractionIndexValid = false;
+}
+
 double Scene::getTime() const
 {
     return sceneTime;
@@ -275,6 +365,64 @@ bool Scene::hasStarted() const
     return (sceneTime == 0);
 }
 
+void Scene::setRouter(Router* routerIn)
+{
+    delete router;
+    router = routerIn;
+    routerRevision = -1;
+}
+
+void Scene::buildRouter()
+{
+    if (router == nullptr)
+        return;
+
+    std::vector<Router::Segment> walls;
+    walls.reserve(obstacles.size());
+    foreach (const Obstacle* obstacle, obstacles)
+        walls.push_back({ obstacle->getax(), obstacle->getay(), obstacle->getbx(), obstacle->getby() });
+
+    // → the waypoints of the scenario, incl. waiting queues
+    std::vector<Router::Goal> goals;
+    goals.reserve(waypoints.size());
+    foreach (const Waypoint* waypoint, waypoints) {
+        const AreaWaypoint* area = dynamic_cast<const AreaWaypoint*>(waypoint);
+        const double radius = (area != nullptr) ? area->getRadius() : 0.5;
+        goals.push_back({ waypoint->getId(), waypoint->getx(), waypoint->gety(), radius });
+    }
+
+    router->build(walls, goals);
+    routerRevision = obstacle_cells_revision_;
+}
+
+bool Scene::getRoutedDirection(int agentId, const Waypoint* waypoint, const Ped::Tvector& position,
+    const Ped::Tvector& target, Ped::Tvector* directionOut)
+{
+    if (router == nullptr)
+        return false;
+
+    // rebuild when the obstacles changed
+    if (routerRevision != obstacle_cells_revision_)
+        buildRouter();
+
+    double dx, dy;
+    if (!router->getDirection(agentId, waypoint->getId(), position.x, position.y, target.x, target.y, dx, dy))
+        return false;
+
+    *directionOut = Ped::Tvector(dx, dy);
+    return true;
+}
+
+EventScheduler::EventId Scene::scheduleEvent(double timeIn, std::function<void()> callback)
+{
+    return events.schedule(timeIn, std::move(callback));
+}
+
+void Scene::cancelEvent(EventScheduler::EventId id)
+{
+    events.cancel(id);
+}
+
 void Scene::dissolveClusters()
 {
     foreach (AgentCluster* cluster, agentClusters) {
@@ -292,6 +440,7 @@ void Scene::dissolveClusters()
             else if (currentGroup->memberCount() > 1) {
                 // keep track of groups
                 agentGroups.append(currentGroup);
+                groupAggregatesValid = false;
             }
 
             // add group's agents to the scene
@@ -329,6 +478,7 @@ void Scene::addAgent(Agent* agent)
 {
     // keep track of the agent
     agents.append(agent);
+    agentsById.insert(agent->getId(), agent);
 
     // add the agent to the PedSim scene
     Ped::Tscene::addAgent(agent);
@@ -388,6 +538,7 @@ void Scene::addWaitingQueue(WaitingQueue* queueIn)
 
     // add waiting queue as waypoint to the scene
     addWaypoint(dynamic_cast<Waypoint*>(queueIn));
+    waitingQueues.append(queueIn);
 
     // inform users
     emit waitingQueueAdded(queueIn->getName());
@@ -403,6 +554,9 @@ void Scene::addAttraction(AttractionArea* attractionIn)
 
     // add attraction to the scene
     attractions.insert(attractionIn->getName(), attractionIn);
+    attractionIndexValid = false;
+    connect(attractionIn, SIGNAL(positionChanged(double, double)),
+        this, SLOT(invalidateAttractionIndex()));
 
     // inform users
     emit attractionAdded(attractionIn->getName());
@@ -412,6 +566,11 @@ bool Scene::removeAgent(Agent* agent)
 {
     // don't keep track of agent anymore
     agents.removeAll(agent);
+    agentsById.remove(agent->getId());
+
+    // → routes are kept per agent id
+    if (router != nullptr)
+        router->forgetAgent(agent->getId());
 
     // remove agent from all groups
     QList<AgentGroup*> groupsToRemove;
@@ -427,8 +586,10 @@ bool Scene::removeAgent(Agent* agent)
     // note: use QObject::deleteLater() to keep the group valid till after the agent's destructor
     foreach (AgentGroup* currentGroup, groupsToRemove) {
         agentGroups.removeAll(currentGroup);
+        currentGroup->aggregateIndex = -1;
         currentGroup->deleteLater();
     }
+    groupAggregatesValid = false;
 
     // inform users
     emit agentRemoved(agent->getId());
@@ -500,6 +661,9 @@ bool Scene::removeWaitingQueue(WaitingQueue* queueIn)
     if (removedCount == 0)
         return false;
 
+    // queues are also kept in their own list
+    waitingQueues.removeAll(queueIn);
+
     // inform users
     emit waitingQueueRemoved(queueIn->getName());
 
@@ -524,6 +688,7 @@ bool Scene::removeAttraction(AttractionArea* attractionInIn)
     // check whether the queue was removed
     if (removedCount == 0)
         return false;
+    attractionIndexValid = false;
 
     // inform users
     emit attractionRemoved(attractionInIn->getName());
@@ -559,6 +724,69 @@ std::set<const Ped::Tagent*> Scene::getNeighbors(double x, double y, double maxD
     return potentialNeighbours;
 }
 
+void Scene::relocateAgent(Agent* agent, const Ped::Tvector& position, const Ped::Tvector& velocity)
+{
+    agent->setPosition(position.x, position.y);
+    agent->setvx(velocity.x);
+    agent->setvy(velocity.y);
+
+    // move the agent within the tree as well
+    Ped::Tscene::moveAgent(agent);
+
+    // the aggregate of the agent's group is outdated, the group is
+    // computed directly until the next tick
+    AgentGroup* group = agent->getGroup();
+    if (group != nullptr)
+        group->aggregateIndex = -1;
+}
+
+// one pass over all groups, the group forces read the flat arrays
+void Scene::updateGroupAggregates()
+{
+    groupAggregates.clear();
+    groupMembers.clear();
+    groupMemberPositions.clear();
+
+    foreach (AgentGroup* group, agentGroups) {
+        GroupAggregate aggregate;
+        aggregate.firstMember = static_cast<int>(groupMembers.size());
+        aggregate.memberCount = group->members.size();
+
+        Ped::Tvector com;
+        foreach (const Agent* member, group->members) {
+            const Ped::Tvector position = member->getPosition();
+            groupMembers.push_back(member);
+            groupMemberPositions.push_back(position);
+            com += position;
+        }
+        if (aggregate.memberCount > 0)
+            com /= aggregate.memberCount;
+        aggregate.centerOfMass = com;
+
+        double maxDistance = 0;
+        for (int i = aggregate.firstMember; i < aggregate.firstMember + aggregate.memberCount; i++)
+            maxDistance = std::max(maxDistance, (com - groupMemberPositions[i]).length());
+        aggregate.maxDistance = maxDistance;
+
+        group->aggregateIndex = static_cast<int>(groupAggregates.size());
+        groupAggregates.push_back(aggregate);
+    }
+
+    groupAggregatesValid = true;
+}
+
+// nullptr if the group is not part of the scene or its members changed
+const Scene::GroupAggregate* Scene::getGroupAggregate(const AgentGroup* group)
+{
+    if (!groupAggregatesValid)
+        updateGroupAggregates();
+
+    const int index = group->aggregateIndex;
+    if (index < 0 || index >= static_cast<int>(groupAggregates.size()))
+        return nullptr;
+    return &groupAggregates[index];
+}
+
 void Scene::moveAllAgents()
 {
     // inform users when there is going to be the first update
@@ -580,10 +808,18 @@ void Scene::moveAllAgents()
     // update scene time
     sceneTime += CONFIG.getTimeStepSize();
     emit sceneTimeChanged(sceneTime);
+    events.runUntil(sceneTime);
+
+    // queueing positions follow the agents ahead
+    foreach (WaitingQueue* queue, waitingQueues)
+        queue->updateQueue();
 
     // move the agents
     Ped::Tscene::moveAgents(CONFIG.getTimeStepSize());
 
+    // group aggregates for the visualization and the next tick
+    updateGroupAggregates();
+
     // inform users
     emit movedAgents();
 }
@@ -593,6 +829,17 @@ void Scene::cleanupScene()
     Ped::Tscene::cleanup();
 }
 
+void Scene::addObstacleCell(int x, int y)
+{
+    // pack both coordinates into a single key (shift the unsigned bits,
+    // shifting negative values is undefined)
+    const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+
+    // skip cells that are already occupied
+    if (obstacle_cell_keys_.insert(key).second)
+        obstacle_cells_.push_back(Location(x, y));
+}
+
 void Scene::drawObstacles(float x1, float y1, float x2, float y2)
 {
     int i; // loop counter
@@ -624,7 +871,7 @@ void Scene::drawObstacles(float x1, float y1, float x2, float y2)
 
     ddy = 2 * dy; // work with double values for full precision
     ddx = 2 * dx;
-    obstacle_cells_.push_back(Location(x, y));
+    addObstacleCell(x, y);
 
     if (ddx >= ddy) {
         // first octant (0 <= slope <= 1)
@@ -642,19 +889,19 @@ void Scene::drawObstacles(float x1, float y1, float x2, float y2)
                 // below):
                 if (error + errorprev < ddx) {
                     // bottom square also
-                    obstacle_cells_.push_back(Location(x, y - ystep));
+                    addObstacleCell(x, y - ystep);
                 }
                 else if (error + errorprev > ddx) {
                     // left square also
-                    obstacle_cells_.push_back(Location(x - xstep, y));
+                    addObstacleCell(x - xstep, y);
                 }
                 else {
                     // corner: bottom and left squares also
-                    obstacle_cells_.push_back(Location(x, y - ystep));
-                    obstacle_cells_.push_back(Location(x - xstep, y));
+                    addObstacleCell(x, y - ystep);
+                    addObstacleCell(x - xstep, y);
                 }
             }
-            obstacle_cells_.push_back(Location(x, y));
+            addObstacleCell(x, y);
             errorprev = error;
         }
     }
@@ -668,19 +915,22 @@ void Scene::drawObstacles(float x1, float y1, float x2, float y2)
                 x += xstep;
                 error -= ddy;
                 if (error + errorprev < ddy) {
-                    obstacle_cells_.push_back(Location(x - xstep, y));
+                    addObstacleCell(x - xstep, y);
                 }
                 else if (error + errorprev > ddy) {
-                    obstacle_cells_.push_back(Location(x, y - ystep));
+                    addObstacleCell(x, y - ystep);
                 }
                 else {
-                    obstacle_cells_.push_back(Location(x - xstep, y));
-                    obstacle_cells_.push_back(Location(x, y - ystep));
+                    addObstacleCell(x - xstep, y);
+                    addObstacleCell(x, y - ystep);
                 }
             }
 
-            obstacle_cells_.push_back(Location(x, y));
+            addObstacleCell(x, y);
             errorprev = error;
         }
     }
+
+    // inform users (publishers) that the cells have changed
+    obstacle_cells_revision_++;
 }
@@ -0,0 +1,141 @@
+/**
+* Copyright 2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/sensor/angulardepthbuffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+AngularDepthBuffer::AngularDepthBuffer(int num_bins)
+    : num_bins_(std::max(8, num_bins))
+    , bin_width_(2.0 * M_PI / num_bins_)
+    , x_(0)
+    , y_(0)
+{
+    depth_.assign(num_bins_, std::numeric_limits<double>::infinity());
+}
+
+AngularDepthBuffer::~AngularDepthBuffer()
+{
+}
+
+void AngularDepthBuffer::reset(double x, double y)
+{
+    x_ = x;
+    y_ = y;
+    std::fill(depth_.begin(), depth_.end(), std::numeric_limits<double>::infinity());
+}
+
+int AngularDepthBuffer::angleToBin(double angle) const
+{
+    int bin = static_cast<int>(std::floor(angle / bin_width_)) % num_bins_;
+    return bin < 0 ? bin + num_bins_ : bin;
+}
+
+void AngularDepthBuffer::addWall(double ax, double ay, double bx, double by)
+{
+    ax -= x_;
+    ay -= y_;
+    bx -= x_;
+    by -= y_;
+
+    // → the bins between the end points (along the shorter arc)
+    double angle_a = std::atan2(ay, ax);
+    double angle_b = std::atan2(by, bx);
+    double span = angle_b - angle_a;
+    if (span > M_PI)
+        span -= 2.0 * M_PI;
+    if (span < -M_PI)
+        span += 2.0 * M_PI;
+    if (span < 0) {
+        std::swap(angle_a, angle_b);
+        std::swap(ax, bx);
+        std::swap(ay, by);
+        span = -span;
+    }
+
+    const double ex = bx - ax, ey = by - ay;
+    const double distance_a = std::hypot(ax, ay), distance_b = std::hypot(bx, by);
+    const int first = angleToBin(angle_a);
+    const int count = angleToBin(angle_a + span) - first;
+    const int num_bins = (count < 0 ? count + num_bins_ : count) + 1;
+
+    for (int k = 0; k < num_bins; k++) {
+        const int bin = (first + k) % num_bins_;
+        const double angle = (bin + 0.5) * bin_width_;
+        const double dx = std::cos(angle), dy = std::sin(angle);
+
+        // distance along the bin's center ray to the wall, the center ray
+        // of the end bins can pass the wall, use the end point then
+        const double denominator = dx * ey - dy * ex;
+        double distance = std::min(distance_a, distance_b);
+        if (std::fabs(denominator) > 1e-12) {
+            const double t = (ax * ey - ay * ex) / denominator;
+            const double u = (ax * dy - ay * dx) / denominator;
+            if (u < 0)
+                distance = distance_a;
+            else if (u > 1)
+                distance = distance_b;
+            else if (t >= 0)
+                distance = t;
+        }
+
+        depth_[bin] = std::min(depth_[bin], distance);
+    }
+}
+
+bool AngularDepthBuffer::testAndInsert(double x, double y, double radius)
+{
+    const double dx = x - x_, dy = y - y_;
+    const double distance = std::hypot(dx, dy);
+    const double near = std::max(0.0, distance - radius);
+
+    // → bins covered by the circle
+    int first = 0, num_bins = num_bins_;
+    if (distance > radius) {
+        const double half_width = std::asin(radius / distance);
+        const double center = std::atan2(dy, dx);
+        first = angleToBin(center - half_width);
+        const int count = angleToBin(center + half_width) - first;
+        num_bins = (count < 0 ? count + num_bins_ : count) + 1;
+    }
+
+    bool visible = false;
+    for (int k = 0; k < num_bins; k++) {
+        double& depth = depth_[(first + k) % num_bins_];
+        if (depth > near) {
+            visible = true;
+            depth = near;
+        }
+    }
+
+    return visible;
+}
@@ -0,0 +1,229 @@
+/**
+* Copyright 2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/sensor/laserscanner.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace {
+// size of the grid cells (m)
+const double CELL_SIZE = 1.0;
+
+// fewer beams per thread are cast faster than handed over
+const int MIN_BEAMS_PER_THREAD = 64;
+
+// ray parameter of the first intersection with a segment, infinity if none
+double intersectSegment(double ox, double oy, double dx, double dy,
+    const LaserScanner::Segment& s)
+{
+    const double ex = s.bx - s.ax, ey = s.by - s.ay;
+    const double denominator = dx * ey - dy * ex;
+    if (std::fabs(denominator) < 1e-12)
+        return std::numeric_limits<double>::infinity();
+
+    const double wx = s.ax - ox, wy = s.ay - oy;
+    const double t = (wx * ey - wy * ex) / denominator;
+    const double u = (wx * dy - wy * dx) / denominator;
+    if (t < 0 || u < 0 || u > 1)
+        return std::numeric_limits<double>::infinity();
+    return t;
+}
+
+// ray parameter of the first intersection with a circle, infinity if none
+double intersectCircle(double ox, double oy, double dx, double dy,
+    const LaserScanner::Circle& c)
+{
+    const double wx = ox - c.x, wy = oy - c.y;
+    const double b = wx * dx + wy * dy;
+    const double q = wx * wx + wy * wy - c.radius * c.radius;
+    const double discriminant = b * b - q;
+    if (discriminant < 0)
+        return std::numeric_limits<double>::infinity();
+
+    const double root = std::sqrt(discriminant);
+    double t = -b - root;
+    if (t < 0)
+        t = -b + root; // sensor inside the circle
+    return t < 0 ? std::numeric_limits<double>::infinity() : t;
+}
+}
+
+LaserScanner::LaserScanner(double angle_min, double angle_max, double angle_increment,
+    double range_max, int num_threads)
+    : angle_min_(angle_min)
+    , angle_max_(angle_max)
+    , angle_increment_(angle_increment)
+    , range_max_(range_max)
+    , generation_(0)
+    , pending_(0)
+    , stopping_(false)
+{
+    num_beams_ = std::max(1, static_cast<int>(std::floor((angle_max - angle_min) / angle_increment)) + 1);
+    num_threads_ = std::max(1, std::min(num_threads, num_beams_ / MIN_BEAMS_PER_THREAD));
+
+    // → the calling thread casts the first chunk itself
+    for (int i = 1; i < num_threads_; i++)
+        workers_.push_back(std::thread(&LaserScanner::runWorker, this, i));
+}
+
+LaserScanner::~LaserScanner()
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (std::thread& worker : workers_)
+        worker.join();
+}
+
+void LaserScanner::setWalls(const std::vector<Segment>& walls)
+{
+    walls_ = walls;
+    if (walls_.empty()) {
+        wall_grid_ = UniformGrid();
+        return;
+    }
+
+    // → grid covering all walls
+    double min_x = std::numeric_limits<double>::max(), min_y = min_x;
+    double max_x = std::numeric_limits<double>::lowest(), max_y = max_x;
+    for (const Segment& s : walls_) {
+        min_x = std::min(min_x, std::min(s.ax, s.bx));
+        min_y = std::min(min_y, std::min(s.ay, s.by));
+        max_x = std::max(max_x, std::max(s.ax, s.bx));
+        max_y = std::max(max_y, std::max(s.ay, s.by));
+    }
+    wall_grid_.reset(min_x - CELL_SIZE, min_y - CELL_SIZE, max_x + CELL_SIZE, max_y + CELL_SIZE, CELL_SIZE);
+
+    for (size_t i = 0; i < walls_.size(); i++)
+        wall_grid_.insertSegment(i, walls_[i].ax, walls_[i].ay, walls_[i].bx, walls_[i].by);
+}
+
+void LaserScanner::scan(double x, double y, double yaw, const std::vector<Circle>& agents,
+    std::vector<float>& ranges)
+{
+    ranges.assign(num_beams_, std::numeric_limits<float>::infinity());
+
+    // → agents grid around the sensor, rebuilt for every scan
+    agent_grid_.reset(x - range_max_, y - range_max_, x + range_max_, y + range_max_, CELL_SIZE);
+    for (size_t i = 0; i < agents.size(); i++) {
+        const Circle& c = agents[i];
+        agent_grid_.insertBox(i, c.x - c.radius, c.y - c.radius, c.x + c.radius, c.y + c.radius);
+    }
+
+    // → beams in chunks, the grids are only read from here on
+    if (workers_.empty()) {
+        castBeams(0, num_beams_, x, y, yaw, agents, ranges);
+        return;
+    }
+
+    const int chunk = (num_beams_ + num_threads_ - 1) / num_threads_;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        job_ = Job{ x, y, yaw, &agents, &ranges, chunk };
+        pending_ = static_cast<int>(workers_.size());
+        generation_++;
+    }
+    work_ready_.notify_all();
+
+    castBeams(0, std::min(num_beams_, chunk), x, y, yaw, agents, ranges);
+
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    work_done_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+void LaserScanner::runWorker(int index)
+{
+    unsigned int done_generation = 0;
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex_);
+            work_ready_.wait(lock, [&]() { return stopping_ || generation_ != done_generation; });
+            if (stopping_)
+                return;
+            done_generation = generation_;
+            job = job_;
+        }
+
+        const int first = std::min(num_beams_, index * job.chunk);
+        const int last = std::min(num_beams_, first + job.chunk);
+        castBeams(first, last, job.x, job.y, job.yaw, *job.agents, *job.ranges);
+
+        bool finished;
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            finished = (--pending_ == 0);
+        }
+        if (finished)
+            work_done_.notify_one();
+    }
+}
+
+void LaserScanner::castBeams(int first, int last, double x, double y, double yaw,
+    const std::vector<Circle>& agents, std::vector<float>& ranges) const
+{
+    for (int i = first; i < last; i++) {
+        const double angle = yaw + angle_min_ + i * angle_increment_;
+        const double dx = std::cos(angle), dy = std::sin(angle);
+
+        const double range = std::min(castWalls(x, y, dx, dy), castAgents(x, y, dx, dy, agents));
+        if (range <= range_max_)
+            ranges[i] = range;
+    }
+}
+
+double LaserScanner::castWalls(double x, double y, double dx, double dy) const
+{
+    double closest = std::numeric_limits<double>::infinity();
+    wall_grid_.traverse(x, y, dx, dy, range_max_, [&](int cell, double t_exit) {
+        for (const int item : wall_grid_.items(cell))
+            closest = std::min(closest, intersectSegment(x, y, dx, dy, walls_[item]));
+        // hits beyond this cell may still be beaten in the next one
+        return closest <= t_exit;
+    });
+    return closest;
+}
+
+double LaserScanner::castAgents(double x, double y, double dx, double dy,
+    const std::vector<Circle>& agents) const
+{
+    double closest = std::numeric_limits<double>::infinity();
+    agent_grid_.traverse(x, y, dx, dy, range_max_, [&](int cell, double t_exit) {
+        for (const int item : agent_grid_.items(cell))
+            closest = std::min(closest, intersectCircle(x, y, dx, dy, agents[item]));
+        return closest <= t_exit;
+    });
+    return closest;
+}
@@ -0,0 +1,100 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/sensor/peopledetector.h>
+
+#include <algorithm>
+#include <cmath>
+
+PeopleDetector::PeopleDetector(double fov, double range_max, double detection_probability,
+    double position_noise, double false_positives)
+    : fov_(std::min(std::max(fov, 0.0), 2 * M_PI))
+    , range_max_(std::max(range_max, 0.0))
+    , detection_probability_(std::min(std::max(detection_probability, 0.0), 1.0))
+    , position_noise_(std::max(position_noise, 0.0))
+    , false_positives_(std::max(false_positives, 0.0))
+{
+}
+
+PeopleDetector::~PeopleDetector() {}
+
+void PeopleDetector::detect(double x, double y, double yaw, const std::vector<Person>& persons,
+    std::default_random_engine& generator, std::vector<Detection>& detections) const
+{
+    detections.clear();
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double c = std::cos(yaw), s = std::sin(yaw);
+    const double half_fov = fov_ / 2;
+
+    for (const Person& person : persons) {
+        // → into the sensor frame
+        const double dx = person.x - x, dy = person.y - y;
+        const double local_x = c * dx + s * dy;
+        const double local_y = -s * dx + c * dy;
+
+        const double distance = std::hypot(local_x, local_y);
+        if (distance > range_max_ || std::fabs(std::atan2(local_y, local_x)) > half_fov)
+            continue;
+        if (uniform(generator) >= detection_probability_)
+            continue;
+
+        Detection detection;
+        detection.id = person.id;
+        detection.x = local_x;
+        detection.y = local_y;
+        if (position_noise_ > 0) {
+            // (a zero standard deviation is not allowed)
+            std::normal_distribution<double> noise(0.0, position_noise_);
+            detection.x += noise(generator);
+            detection.y += noise(generator);
+        }
+        // → farther persons are detected less confidently
+        detection.confidence = range_max_ > 0 ? 1.0 - 0.5 * distance / range_max_ : 1.0;
+        detections.push_back(detection);
+    }
+
+    // → clutter, uniformly distributed over the area of the sector
+    if (false_positives_ > 0 && range_max_ > 0) {
+        std::poisson_distribution<int> clutter(false_positives_);
+        const int num_false_positives = clutter(generator);
+        for (int i = 0; i < num_false_positives; i++) {
+            const double r = range_max_ * std::sqrt(uniform(generator));
+            const double phi = (uniform(generator) - 0.5) * fov_;
+
+            Detection detection;
+            detection.id = -1;
+            detection.x = r * std::cos(phi);
+            detection.y = r * std::sin(phi);
+            detection.confidence = 0.5 * uniform(generator);
+            detections.push_back(detection);
+        }
+    }
+}
@@ -30,15 +30,28 @@
 */
 
 #include <QApplication>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 #include <pedsim_simulator/element/agentcluster.h>
+#include <pedsim_simulator/element/obstacle.h>
+#include <pedsim_simulator/rng.h>
 #include <pedsim_simulator/scene.h>
 #include <pedsim_simulator/simulator.h>
 
 const double PERSON_MESH_SCALE = 2.0 / 8.5 * 1.8;
 
-Simulator::Simulator(const ros::NodeHandle& node)
-    : nh_(node)
+// after an overrun the real time loop sleeps at least this fraction of a period
+const int OVERRUN_IDLE_DIVISOR = 10;
+
+Simulator::Simulator(const ros::NodeHandle& node, const ros::NodeHandle& private_node)
+    : server_(private_node)
+    , nh_(node)
+    , private_nh_(private_node)
+    , paused_(false)
+    , stop_requested_(false)
+    , has_pending_config_(false)
 {
     dynamic_reconfigure::Server<SimConfig>::CallbackType f;
     f = boost::bind(&Simulator::reconfigureCB, this, _1, _2);
@@ -58,14 +71,32 @@ Simulator::~Simulator()
     pub_obstacles_.shutdown();
     pub_all_agents_.shutdown();
     pub_tracked_persons_.shutdown();
+    pub_tracked_persons_full_.shutdown();
+    pub_visible_persons_.shutdown();
+    pub_tracked_persons_local_.shutdown();
     pub_tracked_groups_.shutdown();
+    pub_agent_states_packed_.shutdown();
+    pub_agent_states_delta_.shutdown();
     pub_social_activities_.shutdown();
     pub_robot_position_.shutdown();
+    pub_laser_scan_.shutdown();
+    pub_detected_persons_.shutdown();
+    pub_crowd_density_.shutdown();
+    pub_crowd_grid_.shutdown();
+    pub_crowd_density_local_.shutdown();
+    pub_crowd_grid_local_.shutdown();
 
     srv_pause_simulation_.shutdown();
     srv_unpause_simulation_.shutdown();
+    srv_get_agent_state_.shutdown();
+    srv_get_all_agents_state_.shutdown();
+    srv_set_agent_state_.shutdown();
+    srv_set_all_agents_state_.shutdown();
 
-    delete robot_;
+    // the scene owns the agents incl. the robot; empty it, so a reloaded
+    // nodelet starts from a clean scene
+    robot_ = nullptr;
+    SCENE.clear();
 
     int returnValue = 0;
     QCoreApplication::exit(returnValue);
@@ -73,10 +104,8 @@ Simulator::~Simulator()
 
 bool Simulator::initializeSimulation()
 {
-    ros::NodeHandle private_nh("~");
-
     int queue_size = 0;
-    private_nh.param<int>("default_queue_size", queue_size, 0);
+    private_nh_.param<int>("default_queue_size", queue_size, 0);
     ROS_INFO_STREAM("Using default queue size of "
         << queue_size << " for publisher queues... "
         << (queue_size == 0
@@ -102,13 +131,23 @@ bool Simulator::initializeSimulation()
 
     // informative topics (data)
     pub_obstacles_ = nh_.advertise<nav_msgs::GridCells>(
-        "/pedsim/static_obstacles", queue_size);
+        "/pedsim/static_obstacles", queue_size, true);
     pub_all_agents_ = nh_.advertise<pedsim_msgs::AllAgentsState>(
         "/pedsim/dynamic_obstacles", queue_size);
     pub_tracked_persons_ = nh_.advertise<pedsim_msgs::TrackedPersons>(
         "/pedsim/tracked_persons", queue_size);
+    pub_tracked_persons_full_ = nh_.advertise<pedsim_msgs::TrackedPersons>(
+        "/pedsim/tracked_persons_full", queue_size);
+    pub_visible_persons_ = nh_.advertise<pedsim_msgs::TrackedPersons>(
+        "/pedsim/visible_persons", queue_size);
+    pub_tracked_persons_local_ = nh_.advertise<pedsim_msgs::TrackedPersons>(
+        "/pedsim/tracked_persons_local", queue_size);
     pub_tracked_groups_ = nh_.advertise<pedsim_msgs::TrackedGroups>(
         "/pedsim/tracked_groups", queue_size);
+    pub_agent_states_packed_ = nh_.advertise<pedsim_msgs::AgentStatesPacked>(
+        "/pedsim/agent_states_packed", queue_size);
+    pub_agent_states_delta_ = nh_.advertise<pedsim_msgs::AgentStatesDelta>(
+        "/pedsim/agent_states_delta", queue_size);
     pub_social_activities_ = nh_.advertise<pedsim_msgs::SocialActivities>(
         "/pedsim/social_activities", queue_size);
     pub_robot_position_ = nh_.advertise<nav_msgs::Odometry>(
@@ -119,15 +158,28 @@ bool Simulator::initializeSimulation()
         "/pedsim/pause_simulation", &Simulator::onPauseSimulation, this);
     srv_unpause_simulation_ = nh_.advertiseService(
         "/pedsim/unpause_simulation", &Simulator::onUnpauseSimulation, this);
+    srv_get_agent_state_ = nh_.advertiseService(
+        "/pedsim/get_agent_state", &Simulator::onGetAgentState, this);
+    srv_get_all_agents_state_ = nh_.advertiseService(
+        "/pedsim/get_all_agents_state", &Simulator::onGetAllAgentsState, this);
+    srv_set_agent_state_ = nh_.advertiseService(
+        "/pedsim/set_agent_state", &Simulator::onSetAgentState, this);
+    srv_set_all_agents_state_ = nh_.advertiseService(
+        "/pedsim/set_all_agents_state", &Simulator::onSetAllAgentsState, this);
 
     /// setup TF listener and other pointers
     transform_listener_.reset(new tf::TransformListener());
+    transform_broadcaster_.reset(new tf::TransformBroadcaster());
     orientation_handler_.reset(new OrientationHandler());
     robot_ = nullptr;
+    obstacles_revision_ = -1;
+    walls_revision_ = -1;
+
+    robot_heading_ = 0.0;
 
     /// load additional parameters
     std::string scene_file_param;
-    private_nh.param<std::string>("scene_file", scene_file_param,
+    private_nh_.param<std::string>("scene_file", scene_file_param,
         "package://pedsim_simulator/scenarios/singleagent.xml");
 
     QString scenefile = QString::fromStdString(scene_file_param);
@@ -138,17 +190,200 @@ bool Simulator::initializeSimulation()
         return false;
     }
 
-    private_nh.param<bool>("enable_groups", CONFIG.groups_enabled, true);
-    private_nh.param<double>("max_robot_speed", CONFIG.max_robot_speed, 1.5);
+    private_nh_.param<bool>("enable_groups", CONFIG.groups_enabled, true);
+    private_nh_.param<double>("max_robot_speed", CONFIG.max_robot_speed, 1.5);
 
     int op_mode = 1;
-    private_nh.param<int>("robot_mode", op_mode, 1); // teleop
+    private_nh_.param<int>("robot_mode", op_mode, 1); // teleop
     CONFIG.robot_mode = static_cast<RobotMode>(op_mode);
 
     int vis_mode = 1;
-    private_nh.param<int>("visual_mode", vis_mode, 1);
+    private_nh_.param<int>("visual_mode", vis_mode, 1);
     CONFIG.visual_mode = static_cast<VisualMode>(vis_mode);
 
+    // robot kinematics: "tf" to follow an external TF frame (e.g. from
+    // simulate_diff_drive_robot), "diff_drive" or "holonomic" to integrate
+    // cmd_vel within the simulation step
+    std::string kinematics;
+    private_nh_.param<std::string>("robot_kinematics", kinematics, "tf");
+    private_nh_.param<double>("cmd_vel_timeout", cmd_vel_timeout_, 0.5);
+    internal_kinematics_ = (kinematics == "diff_drive" || kinematics == "holonomic");
+    kinematics_model_ = (kinematics == "holonomic") ? RobotKinematics::HOLONOMIC : RobotKinematics::DIFF_DRIVE;
+    if (!internal_kinematics_ && kinematics != "tf")
+        ROS_WARN_STREAM("Unknown robot_kinematics '" << kinematics << "', following TF");
+    if (internal_kinematics_ && CONFIG.robot_mode != RobotMode::TELEOPERATION) {
+        ROS_WARN("robot_kinematics is only used in teleoperation mode, following TF");
+        internal_kinematics_ = false;
+    }
+    robots_.clear();
+
+    // frame of the robot centric messages
+    private_nh_.param<std::string>("robot_frame", robot_frame_, "base_footprint");
+
+    // occlusions of the persons as seen from the robot
+    private_nh_.param<bool>("compute_occlusions", compute_occlusions_, true);
+    occluded_agents_.clear();
+
+    // simulated laser scanner
+    bool laser_enabled = false;
+    private_nh_.param<bool>("laser_enabled", laser_enabled, false);
+    if (laser_enabled) {
+        double angle_min, angle_max, resolution, range_max, rate;
+        int num_threads;
+        private_nh_.param<double>("laser_angle_min", angle_min, -2.35);
+        private_nh_.param<double>("laser_angle_max", angle_max, 2.35);
+        private_nh_.param<double>("laser_resolution", resolution, 0.0044);
+        private_nh_.param<double>("laser_range_max", range_max, 30.0);
+        private_nh_.param<double>("laser_rate", rate, 10.0);
+        private_nh_.param<int>("laser_threads", num_threads, 4);
+        private_nh_.param<std::string>("laser_frame", laser_frame_, "base_footprint");
+
+        laser_scanner_.reset(new LaserScanner(angle_min, angle_max, resolution, range_max, num_threads));
+        laser_period_ = rate > 0 ? 1.0 / rate : 0.0;
+        laser_next_scan_time_ = 0.0;
+        laser_walls_revision_ = -1;
+        pub_laser_scan_ = nh_.advertise<sensor_msgs::LaserScan>("/pedsim/scan", queue_size);
+    }
+
+    // simulated people detector
+    bool detector_enabled = false;
+    private_nh_.param<bool>("detector_enabled", detector_enabled, false);
+    if (detector_enabled) {
+        double fov, range_max, detection_probability, position_noise, false_positives, rate;
+        private_nh_.param<double>("detector_fov", fov, 2 * M_PI);
+        private_nh_.param<double>("detector_range_max", range_max, 15.0);
+        private_nh_.param<double>("detector_probability", detection_probability, 0.95);
+        private_nh_.param<double>("detector_position_noise", position_noise, 0.05);
+        private_nh_.param<double>("detector_false_positives", false_positives, 0.1);
+        private_nh_.param<double>("detector_rate", rate, 30.0);
+        private_nh_.param<std::string>("detector_frame", detector_frame_, "base_footprint");
+
+        people_detector_.reset(new PeopleDetector(fov, range_max, detection_probability,
+            position_noise, false_positives));
+        detector_period_ = rate > 0 ? 1.0 / rate : 0.0;
+        detector_next_time_ = 0.0;
+        detection_id_counter_ = 0;
+        pub_detected_persons_ = nh_.advertise<pedsim_msgs::DetectedPersons>(
+            "/pedsim/detected_persons", queue_size);
+    }
+
+    // crowd density and velocity raster
+    bool crowd_grid_enabled = false;
+    private_nh_.param<bool>("crowd_grid_enabled", crowd_grid_enabled, false);
+    if (crowd_grid_enabled) {
+        double resolution, rate;
+        private_nh_.param<double>("crowd_grid_resolution", resolution, 0.5);
+        private_nh_.param<double>("crowd_grid_rate", rate, 5.0);
+        private_nh_.param<double>("crowd_grid_local_size", crowd_grid_local_size_, 10.0);
+        private_nh_.param<double>("crowd_grid_max_density", crowd_grid_max_density_, 2.0);
+
+        // → covers the scene as loaded, agents walking outside are not counted
+        const QRectF bounds = SCENE.itemsBoundingRect();
+        crowd_grid_.reset(new CrowdGrid());
+        crowd_grid_->resize(bounds.left(), bounds.top(), bounds.width(), bounds.height(),
+            resolution > 0 ? resolution : 0.5);
+        crowd_grid_period_ = rate > 0 ? 1.0 / rate : 0.0;
+        crowd_grid_next_time_ = 0.0;
+
+        pub_crowd_density_ = nh_.advertise<nav_msgs::OccupancyGrid>(
+            "/pedsim/crowd_density", 1, true);
+        pub_crowd_grid_ = nh_.advertise<pedsim_msgs::CrowdGrid>(
+            "/pedsim/crowd_grid", 1, true);
+        pub_crowd_density_local_ = nh_.advertise<nav_msgs::OccupancyGrid>(
+            "/pedsim/crowd_density_local", queue_size);
+        pub_crowd_grid_local_ = nh_.advertise<pedsim_msgs::CrowdGrid>(
+            "/pedsim/crowd_grid_local", queue_size);
+    }
+
+    // global routing: "direct" walks straight towards the waypoints,
+    // "flow_field" around the obstacles along one flow field per waypoint,
+    // "visibility_graph" along cached shortest paths over the wall corners
+    std::string routing;
+    private_nh_.param<std::string>("routing", routing, "direct");
+    double clearance;
+    private_nh_.param<double>("routing_clearance", clearance, 0.3);
+    if (routing == "flow_field") {
+        double resolution;
+        private_nh_.param<double>("routing_resolution", resolution, 0.5);
+        SCENE.setRouter(new FlowFieldRouter(resolution > 0 ? resolution : 0.5, clearance));
+        SCENE.buildRouter();
+    }
+    else if (routing == "visibility_graph") {
+        double corridor_width;
+        int cache_size;
+        private_nh_.param<double>("routing_corridor_width", corridor_width, 1.5);
+        private_nh_.param<int>("routing_cache_size", cache_size, 64);
+        SCENE.setRouter(new VisibilityGraphRouter(clearance, corridor_width, std::max(1, cache_size)));
+        SCENE.buildRouter();
+    }
+    else {
+        if (routing != "direct")
+            ROS_WARN_STREAM("Unknown routing '" << routing << "', walking straight to the waypoints");
+        SCENE.setRouter(nullptr);
+    }
+
+    // level of detail around the robot (lod_full_radius 0 - everyone in full detail)
+    double lod_full_radius, lod_half_radius, lod_quarter_radius, lod_hysteresis;
+    private_nh_.param<double>("lod_full_radius", lod_full_radius, 0.0);
+    private_nh_.param<double>("lod_half_radius", lod_half_radius, 15.0);
+    private_nh_.param<double>("lod_quarter_radius", lod_quarter_radius, 25.0);
+    private_nh_.param<double>("lod_hysteresis", lod_hysteresis, 2.0);
+    SCENE.setLevelOfDetail(lod_full_radius, lod_half_radius, lod_quarter_radius, lod_hysteresis);
+
+    // agents standing still fall asleep (sleep_steps 0 - never)
+    int sleep_steps;
+    double sleep_speed, sleep_force, wake_radius;
+    private_nh_.param<int>("sleep_steps", sleep_steps, 0);
+    private_nh_.param<double>("sleep_speed", sleep_speed, 0.05);
+    private_nh_.param<double>("sleep_force", sleep_force, 0.1);
+    private_nh_.param<double>("wake_radius", wake_radius, 2.0);
+    SCENE.setSleepDetection(sleep_steps, sleep_speed, sleep_force, wake_radius);
+
+    // integration of the agents' forces, stiff steps are split into up to max_substeps
+    std::string integrator;
+    int max_substeps;
+    private_nh_.param<std::string>("integrator", integrator, "euler");
+    private_nh_.param<int>("max_substeps", max_substeps, 1);
+    Ped::Tagent::Integrator scheme = Ped::Tagent::EULER;
+    if (integrator == "semi_implicit_euler")
+        scheme = Ped::Tagent::SEMI_IMPLICIT_EULER;
+    else if (integrator == "velocity_verlet")
+        scheme = Ped::Tagent::VELOCITY_VERLET;
+    else if (integrator != "euler")
+        ROS_WARN_STREAM("Unknown integrator '" << integrator << "', using euler");
+    SCENE.setIntegrator(scheme, max_substeps);
+
+    // area of interest (robot and additional frames)
+    private_nh_.param<double>("aoi_radius", aoi_radius_, 0.0);
+    private_nh_.param("aoi_frames", aoi_frames_, std::vector<std::string>());
+    aoi_agents_.clear();
+
+    // delta encoded agent states
+    private_nh_.param<int>("delta_keyframe_interval", delta_keyframe_interval_, 50);
+    private_nh_.param<double>("delta_position_threshold", delta_position_threshold_, 0.01);
+    private_nh_.param<double>("delta_velocity_threshold", delta_velocity_threshold_, 0.01);
+    delta_sent_states_.clear();
+    delta_sequence_ = 0;
+    delta_ticks_since_keyframe_ = -1;
+
+    // real time loop
+    std::string overrun_policy;
+    private_nh_.param<bool>("realtime", realtime_, false);
+    private_nh_.param<std::string>("overrun_policy", overrun_policy, "slow_time");
+    private_nh_.param<int>("max_catch_up_steps", max_catch_up_steps_, 4);
+    if (overrun_policy == "drop_publish")
+        overrun_policy_ = OverrunPolicy::DROP_PUBLISH;
+    else if (overrun_policy == "substep")
+        overrun_policy_ = OverrunPolicy::SUBSTEP;
+    else {
+        if (overrun_policy != "slow_time")
+            ROS_WARN_STREAM("Unknown overrun_policy '" << overrun_policy << "', using slow_time");
+        overrun_policy_ = OverrunPolicy::SLOW_TIME;
+    }
+    catch_up_steps_ = 0;
+    skip_publishing_ = false;
+    tick_statistics_.reset();
+
     agent_activities_.clear();
     paused_ = false;
 
@@ -161,58 +396,344 @@ bool Simulator::initializeSimulation()
 /// -----------------------------------------------------------------
 void Simulator::runSimulation()
 {
+    if (realtime_) {
+        runRealtimeSimulation();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(scene_mutex_);
+        applyPendingConfig();
+    }
     ros::Rate r(CONFIG.updateRate); // Hz
 
-    while (ros::ok()) {
-        if (SCENE.getTime() < 0.1) {
-            // setup the robot
-            for (Agent* a : SCENE.getAgents()) {
-                if (a->getType() == Ped::Tagent::ROBOT) {
-                    robot_ = a;
-
-                    // init default pose of robot
-                    Eigen::Quaternionf q = computePose(robot_);
-                    last_robot_orientation_.x = q.x();
-                    last_robot_orientation_.y = q.y();
-                    last_robot_orientation_.z = q.z();
-                    last_robot_orientation_.w = q.w();
-                }
-            }
+    while (ros::ok() && !stop_requested_) {
+        {
+            // services may modify the agents, but only between steps
+            std::lock_guard<std::mutex> lock(scene_mutex_);
+            simulateStep();
         }
 
-        updateRobotPositionFromTF(); // move robot
-        if (!paused_)
-            SCENE.moveAllAgents(); // move all the pedestrians
+        r.sleep();
+    }
+}
+
+/// -----------------------------------------------------------------
+/// \brief setupRealtimeThread
+/// \details Scheduling of the calling (simulation) thread. Failures
+/// are reported, the loop still runs without the setting
+/// -----------------------------------------------------------------
+void Simulator::setupRealtimeThread()
+{
+    std::string error;
+
+    bool lock_memory = false;
+    private_nh_.param<bool>("realtime_lock_memory", lock_memory, false);
+    if (lock_memory && !realtime::lockMemory(error))
+        ROS_WARN_STREAM("Could not lock memory: " << error);
+
+    // the ROS transport threads are not affected, pin the process to keep them elsewhere
+    std::vector<int> cpus;
+    private_nh_.param("realtime_cpus", cpus, std::vector<int>());
+    if (!cpus.empty() && !realtime::setCpuAffinity(cpus, error))
+        ROS_WARN_STREAM("Could not set CPU affinity of the simulation thread: " << error);
+
+    int priority = 0;
+    private_nh_.param<int>("realtime_priority", priority, 0);
+    if (priority > 0 && !realtime::setFifoPriority(priority, error))
+        ROS_WARN_STREAM("Could not set SCHED_FIFO priority " << priority << ": " << error);
+}
+
+/// -----------------------------------------------------------------
+/// \brief runRealtimeSimulation
+/// \details Simulation loop with fixed deadlines on the wall clock.
+/// Overruns are counted and handled by the overrun policy:
+/// - drop_publish: the next ticks only compute, back to back until
+///   they are on time again
+/// - substep: the next tick does extra steps to catch up with the
+///   wall clock (at most max_catch_up_steps), the schedule skips the
+///   periods they cover
+/// - slow_time: the deadlines are moved, simulated time falls behind
+/// When the schedule is restarted, the loop sleeps for a tenth of a
+/// period so that it can not starve the ROS threads.
+/// -----------------------------------------------------------------
+void Simulator::runRealtimeSimulation()
+{
+    typedef std::chrono::steady_clock Clock;
 
-        // mandatory data stream
-        publishData();
-        publishRobotPosition();
-        publishObstacles();
+    setupRealtimeThread();
+    {
+        std::lock_guard<std::mutex> lock(scene_mutex_);
+        applyPendingConfig();
+    }
 
-        if (CONFIG.visual_mode == VisualMode::MINIMAL) {
-            publishAgents(); // animated markers
+    Clock::time_point deadline = Clock::now();
+    while (ros::ok() && !stop_requested_) {
+        const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / CONFIG.updateRate));
+        deadline += period;
 
-            if (SCENE.getTime() < 20) {
-                publishWalls();
+        const Clock::time_point start = Clock::now();
+        {
+            // services may modify the agents, but only between steps
+            std::lock_guard<std::mutex> lock(scene_mutex_);
+            simulateStep();
+        }
+        const Clock::time_point end = Clock::now();
+
+        const double duration = std::chrono::duration<double>(end - start).count();
+        const double lateness = std::chrono::duration<double>(end - deadline).count();
+        tick_statistics_.addTick(duration, lateness);
+
+        skip_publishing_ = false;
+        catch_up_steps_ = 0;
+        if (lateness > 0) {
+            ROS_WARN_STREAM_THROTTLE(5.0, "Simulation tick overran by " << lateness * 1000.0
+                    << " ms (" << tick_statistics_.toString() << ")");
+
+            bool restart = false;
+            switch (overrun_policy_) {
+            case OverrunPolicy::DROP_PUBLISH:
+                // → the next ticks run back to back until they are on time again
+                skip_publishing_ = true;
+                restart = lateness > max_catch_up_steps_ / CONFIG.updateRate;
+                break;
+            case OverrunPolicy::SUBSTEP:
+                // → the extra steps cover the periods that were missed, the
+                // schedule moves on by as much (the rest is dropped)
+                catch_up_steps_ = std::min(max_catch_up_steps_,
+                    static_cast<int>(std::ceil(lateness * CONFIG.updateRate)));
+                deadline += catch_up_steps_ * period;
+                restart = deadline < end;
+                break;
+            case OverrunPolicy::SLOW_TIME:
+                restart = true;
+                break;
             }
+
+            if (!restart && deadline < end)
+                continue;
+
+            // → restart the schedule instead of bursting to catch up, and
+            // leave the CPU to the ROS threads for a moment (the loop may
+            // run with SCHED_FIFO priority)
+            if (restart)
+                deadline = end + period / OVERRUN_IDLE_DIVISOR;
         }
 
-        if (CONFIG.visual_mode == VisualMode::FULL) {
-            publishSocialActivities();
-            publishGroupVisuals();
-            updateAgentActivities();
+        std::this_thread::sleep_until(deadline);
+    }
+
+    ROS_INFO_STREAM("Real time loop finished: " << tick_statistics_.toString());
+}
 
-            if (SCENE.getTime() < 20) {
-                publishAttractions();
-                publishWalls();
+/// -----------------------------------------------------------------
+/// \brief simulateStep
+/// \details Advance the simulation by one step and publish the data
+/// -----------------------------------------------------------------
+void Simulator::simulateStep()
+{
+    applyPendingConfig();
+
+    if (SCENE.getTime() < 0.1) {
+        // setup the robot
+        for (Agent* a : SCENE.getAgents()) {
+            if (a->getType() == Ped::Tagent::ROBOT) {
+                robot_ = a;
+
+                // init default pose of robot
+                Eigen::Quaternionf q = computePose(robot_);
+                last_robot_orientation_.x = q.x();
+                last_robot_orientation_.y = q.y();
+                last_robot_orientation_.z = q.z();
+                last_robot_orientation_.w = q.w();
             }
         }
 
-        ros::spinOnce();
-        r.sleep();
+        if (internal_kinematics_) {
+            if (robots_.empty())
+                setupRobots();
+            // the first one is the robot the sensors are mounted on
+            if (!robots_.empty())
+                robot_ = robots_.front()->agent;
+        }
+    }
+
+    // move robot(s) and all the pedestrians, with extra steps when
+    // catching up after an overrun
+    const int num_steps = 1 + catch_up_steps_;
+    for (int step = 0; step < num_steps; step++) {
+        if (internal_kinematics_)
+            updateRobots();
+        else if (step == 0)
+            updateRobotPositionFromTF();
+        if (!paused_)
+            SCENE.moveAllAgents();
+    }
+    updateRobotHeading();
+    updateAreaOfInterest();
+    updateCrowdGrid();
+
+    if (skip_publishing_) {
+        // → overrun: only keep the robot transforms going
+        publishRobotOdometry();
+        return;
+    }
+
+    // mandatory data stream
+    publishData();
+    publishAgentStatesPacked();
+    publishAgentStatesDelta();
+    publishRobotPosition();
+    publishRobotOdometry();
+    publishLaserScan();
+    publishDetectedPersons();
+    publishCrowdGrid();
+    publishObstacles();
+
+    if (CONFIG.visual_mode == VisualMode::MINIMAL) {
+        publishAgents(); // animated markers
+        publishWalls();
+    }
+
+    if (CONFIG.visual_mode == VisualMode::FULL) {
+        publishSocialActivities();
+        publishGroupVisuals();
+        updateAgentActivities();
+        publishWalls();
+
+        if (SCENE.getTime() < 20) {
+            publishAttractions();
+        }
+    }
+}
+
+/// -----------------------------------------------------------------
+/// \brief updateRobotHeading
+/// \details Keep track of the robot's yaw, taken from TF when the
+/// robot is driven externally, otherwise from its walking direction
+/// -----------------------------------------------------------------
+void Simulator::updateRobotHeading()
+{
+    if (robot_ == nullptr)
+        return;
+
+    if (internal_kinematics_ && !robots_.empty()) {
+        robot_heading_ = robots_.front()->kinematics.getTheta();
+    }
+    else if (CONFIG.robot_mode == RobotMode::TELEOPERATION || CONFIG.robot_mode == RobotMode::CONTROLLED) {
+        robot_heading_ = tf::getYaw(last_robot_pose_.getRotation());
+    }
+    else if (hypot(robot_->getvx(), robot_->getvy()) >= 0.05) {
+        robot_heading_ = atan2(robot_->getvy(), robot_->getvx());
+    }
+}
+
+/// -----------------------------------------------------------------
+/// \brief updateOcclusions
+/// \details Determine which agents the robot cannot see. Walls are
+/// drawn into an angular depth buffer around the robot, then the
+/// agents are tested and drawn from near to far, so that both walls
+/// and closer agents block the view. O(n log n) for the sorting, the
+/// rest is linear in the number of agents and covered bins.
+/// -----------------------------------------------------------------
+void Simulator::updateOcclusions()
+{
+    occluded_agents_.clear();
+    if (!compute_occlusions_ || robot_ == nullptr)
+        return;
+
+    const double x = robot_->getx(), y = robot_->gety();
+    depth_buffer_.reset(x, y);
+    for (const Obstacle* obstacle : SCENE.getObstacles())
+        depth_buffer_.addWall(obstacle->getax(), obstacle->getay(), obstacle->getbx(), obstacle->getby());
+
+    std::vector<std::pair<double, const Agent*> > by_distance;
+    by_distance.reserve(SCENE.getAgents().size());
+    for (const Agent* a : SCENE.getAgents()) {
+        if (a != robot_)
+            by_distance.push_back(std::make_pair(hypot(a->getx() - x, a->gety() - y), a));
+    }
+    std::sort(by_distance.begin(), by_distance.end());
+
+    for (const auto& entry : by_distance) {
+        const Agent* a = entry.second;
+        if (!depth_buffer_.testAndInsert(a->getx(), a->gety(), a->getRadius()))
+            occluded_agents_.insert(a->getId());
     }
 }
 
+/// -----------------------------------------------------------------
+/// \brief updateAreaOfInterest
+/// \details Collect the agents within aoi_radius of the robot and of
+/// the configured frames using the spatial index of the scene, so the
+/// cost depends on the number of agents found, not the crowd size
+/// -----------------------------------------------------------------
+void Simulator::updateAreaOfInterest()
+{
+    aoi_agents_.clear();
+    if (aoi_radius_ <= 0)
+        return;
+
+    std::vector<Ped::Tvector> centers;
+    if (robot_ != nullptr)
+        centers.push_back(robot_->getPosition());
+
+    for (const std::string& frame : aoi_frames_) {
+        tf::StampedTransform transform;
+        try {
+            transform_listener_->lookupTransform("odom", frame, ros::Time(0), transform);
+        }
+        catch (tf::TransformException& e) {
+            ROS_WARN_STREAM_THROTTLE(5.0, "TF lookup from " << frame << " to odom failed. Reason: " << e.what());
+            continue;
+        }
+        centers.push_back(Ped::Tvector(transform.getOrigin().x(), transform.getOrigin().y()));
+    }
+
+    // → union of the neighborhoods, keep robots as well. The quadtree
+    // returns whole leaves, so the radius has to be checked here
+    std::vector<Agent*> selected;
+    for (const Ped::Tvector& center : centers) {
+        std::set<const Ped::Tagent*> neighbors = SCENE.getNeighbors(center.x, center.y, aoi_radius_);
+        for (const Ped::Tagent* neighbor : neighbors) {
+            if ((neighbor->getPosition() - center).length() <= aoi_radius_)
+                selected.push_back(const_cast<Agent*>(dynamic_cast<const Agent*>(neighbor)));
+        }
+    }
+    if (robot_ != nullptr)
+        selected.push_back(robot_);
+
+    // → order by id, so the messages do not depend on pointer values
+    std::sort(selected.begin(), selected.end(), [](const Agent* a, const Agent* b) {
+        return a->getId() < b->getId();
+    });
+    selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
+
+    for (Agent* agent : selected)
+        aoi_agents_.append(agent);
+}
+
+/// -----------------------------------------------------------------
+/// \brief getPublishedAgents
+/// \details Agents to publish on the regular topics, either all of
+/// them or those in the area of interest
+/// -----------------------------------------------------------------
+const QList<Agent*>& Simulator::getPublishedAgents() const
+{
+    return aoi_radius_ > 0 ? aoi_agents_ : SCENE.getAgents();
+}
+
+/// -----------------------------------------------------------------
+/// \brief stopSimulation
+/// \details Request the simulation loop to return after the current
+/// step. Used when running as a nodelet in its own thread
+/// -----------------------------------------------------------------
+void Simulator::stopSimulation()
+{
+    stop_requested_ = true;
+}
+
 /**
  * @brief reconfigure call back
  * @details Callback function that receives parameters from the dynamic
@@ -223,23 +744,39 @@ void Simulator::runSimulation()
 void Simulator::reconfigureCB(pedsim_simulator::PedsimSimulatorConfig& config,
     uint32_t level)
 {
-    CONFIG.updateRate = config.update_rate;
-    CONFIG.simulationFactor = config.simulation_factor;
-
-    // update force scaling factors
-    CONFIG.setObstacleForce(config.force_obstacle);
-    CONFIG.setObstacleSigma(config.sigma_obstacle);
-    CONFIG.setSocialForce(config.force_social);
-    CONFIG.setGroupGazeForce(config.force_group_gaze);
-    CONFIG.setGroupCoherenceForce(config.force_group_coherence);
-    CONFIG.setGroupRepulsionForce(config.force_group_repulsion);
-    CONFIG.setRandomForce(config.force_random);
-    CONFIG.setAlongWallForce(config.force_wall);
+    // applied by the simulation thread between steps, the forces
+    // listening to CONFIG live in that thread
+    std::lock_guard<std::mutex> lock(scene_mutex_);
+    pending_config_ = config;
+    has_pending_config_ = true;
 
     // puase or unpause the simulation
-    if (paused_ != config.paused) {
-        paused_ = config.paused;
-    }
+    paused_ = config.paused;
+}
+
+/// -----------------------------------------------------------------
+/// \brief applyPendingConfig
+/// \details Apply the last dynamic reconfigure parameters, call with
+/// scene_mutex_ held from the simulation thread
+/// -----------------------------------------------------------------
+void Simulator::applyPendingConfig()
+{
+    if (!has_pending_config_)
+        return;
+    has_pending_config_ = false;
+
+    CONFIG.updateRate = pending_config_.update_rate;
+    CONFIG.simulationFactor = pending_config_.simulation_factor;
+
+    // update force scaling factors
+    CONFIG.setObstacleForce(pending_config_.force_obstacle);
+    CONFIG.setObstacleSigma(pending_config_.sigma_obstacle);
+    CONFIG.setSocialForce(pending_config_.force_social);
+    CONFIG.setGroupGazeForce(pending_config_.force_group_gaze);
+    CONFIG.setGroupCoherenceForce(pending_config_.force_group_coherence);
+    CONFIG.setGroupRepulsionForce(pending_config_.force_group_repulsion);
+    CONFIG.setRandomForce(pending_config_.force_random);
+    CONFIG.setAlongWallForce(pending_config_.force_wall);
 }
 
 /// -----------------------------------------------------------------
@@ -264,6 +801,139 @@ bool Simulator::onUnpauseSimulation(std_srvs::Empty::Request& request,
     return true;
 }
 
+/// -----------------------------------------------------------------
+/// \brief onGetAgentState
+/// \details Return the state of a single agent
+/// -----------------------------------------------------------------
+bool Simulator::onGetAgentState(pedsim_srvs::GetAgentState::Request& request,
+    pedsim_srvs::GetAgentState::Response& response)
+{
+    std::lock_guard<std::mutex> lock(scene_mutex_);
+
+    Agent* a = SCENE.getAgentById(request.agent_id);
+    if (a == nullptr) {
+        ROS_WARN_STREAM("Unknown agent id " << request.agent_id);
+        return false;
+    }
+
+    response.state = agentToState(a);
+    return true;
+}
+
+/// -----------------------------------------------------------------
+/// \brief onGetAllAgentsState
+/// \details Return the states of the requested agents, all agents if
+/// no ids are given
+/// -----------------------------------------------------------------
+bool Simulator::onGetAllAgentsState(pedsim_srvs::GetAllAgentsState::Request& request,
+    pedsim_srvs::GetAllAgentsState::Response& response)
+{
+    std::lock_guard<std::mutex> lock(scene_mutex_);
+
+    response.agent_states.header.stamp = ros::Time::now();
+    response.agent_states.header.frame_id = "odom";
+
+    if (request.agent_ids.empty()) {
+        response.agent_states.agent_states.reserve(SCENE.getAgents().size());
+        for (const Agent* a : SCENE.getAgents())
+            response.agent_states.agent_states.push_back(agentToState(a));
+        return true;
+    }
+
+    response.agent_states.agent_states.reserve(request.agent_ids.size());
+    for (const int16_t id : request.agent_ids) {
+        Agent* a = SCENE.getAgentById(id);
+        if (a == nullptr) {
+            ROS_WARN_STREAM("Unknown agent id " << id);
+            return false;
+        }
+        response.agent_states.agent_states.push_back(agentToState(a));
+    }
+
+    return true;
+}
+
+/// -----------------------------------------------------------------
+/// \brief onSetAgentState
+/// \details Set position and velocity of a single agent
+/// -----------------------------------------------------------------
+bool Simulator::onSetAgentState(pedsim_srvs::SetAgentState::Request& request,
+    pedsim_srvs::SetAgentState::Response& response)
+{
+    std::lock_guard<std::mutex> lock(scene_mutex_);
+
+    const pedsim_msgs::AgentState& state = request.state;
+    Agent* a = SCENE.getAgentById(state.id);
+    if (a == nullptr) {
+        ROS_WARN_STREAM("Unknown agent id " << state.id);
+        response.finished = false;
+        return true;
+    }
+
+    applyAgentState(a, state);
+
+    response.finished = true;
+    return true;
+}
+
+/// -----------------------------------------------------------------
+/// \brief onSetAllAgentsState
+/// \details Set position and velocity of a batch of agents. Nothing
+/// is changed if any of the ids is unknown. The batch is applied
+/// between two simulation steps
+/// -----------------------------------------------------------------
+bool Simulator::onSetAllAgentsState(pedsim_srvs::SetAllAgentsState::Request& request,
+    pedsim_srvs::SetAllAgentsState::Response& response)
+{
+    std::lock_guard<std::mutex> lock(scene_mutex_);
+
+    const std::vector<pedsim_msgs::AgentState>& states = request.agent_states.agent_states;
+
+    // → validate the whole batch first
+    std::vector<Agent*> targets;
+    targets.reserve(states.size());
+    for (const pedsim_msgs::AgentState& state : states) {
+        Agent* a = SCENE.getAgentById(state.id);
+        if (a == nullptr) {
+            ROS_WARN_STREAM("Unknown agent id " << state.id << ", ignoring the batch");
+            response.finished = false;
+            return true;
+        }
+        targets.push_back(a);
+    }
+
+    // → apply it
+    for (size_t i = 0; i < states.size(); i++)
+        applyAgentState(targets[i], states[i]);
+
+    response.finished = true;
+    return true;
+}
+
+/// -----------------------------------------------------------------
+/// \brief applyAgentState
+/// \details Move an agent to the position and velocity of a state
+/// message. Robots driven by the internal kinematics also get the new
+/// pose there, else the next step would move them back
+/// -----------------------------------------------------------------
+void Simulator::applyAgentState(Agent* agent, const pedsim_msgs::AgentState& state)
+{
+    SCENE.relocateAgent(agent,
+        Ped::Tvector(state.pose.position.x, state.pose.position.y),
+        Ped::Tvector(state.twist.linear.x, state.twist.linear.y));
+
+    for (auto& robot : robots_) {
+        if (robot->agent != agent)
+            continue;
+
+        // → keep the heading if the state has no valid orientation
+        const geometry_msgs::Quaternion& q = state.pose.orientation;
+        const bool has_orientation = q.x != 0 || q.y != 0 || q.z != 0 || q.w != 0;
+        robot->kinematics.setPose(state.pose.position.x, state.pose.position.y,
+            has_orientation ? tf::getYaw(q) : robot->kinematics.getTheta());
+    }
+}
+
 /// -----------------------------------------------------------------
 /// \brief updateAgentActivities
 /// \details Update the map of activities of each agent for visuals
@@ -355,6 +1025,126 @@ void Simulator::updateRobotPositionFromTF()
     }
 }
 
+/// -----------------------------------------------------------------
+/// \brief setupRobots
+/// \details Create a kinematic model for every robot agent. The
+/// first robot keeps the names used with simulate_diff_drive_robot
+/// (/pedbot/control/cmd_vel, base_footprint), the others are
+/// namespaced as pedbot_<i>
+/// -----------------------------------------------------------------
+void Simulator::setupRobots()
+{
+    double initial_theta;
+    private_nh_.param<double>("robot_initial_theta", initial_theta, 0.0);
+
+    for (Agent* a : SCENE.getAgents()) {
+        if (a->getType() != Ped::Tagent::ROBOT)
+            continue;
+
+        const size_t index = robots_.size();
+        const std::string prefix = index == 0 ? "" : "pedbot_" + std::to_string(index);
+
+        std::unique_ptr<SimulatedRobot> robot(new SimulatedRobot);
+        robot->agent = a;
+        robot->kinematics = RobotKinematics(kinematics_model_, a->getx(), a->gety(),
+            index == 0 ? initial_theta : 0.0);
+        robot->kinematics.setMaxSpeed(CONFIG.max_robot_speed);
+        robot->frame = index == 0 ? "base_footprint" : prefix + "/base_footprint";
+        robot->last_command = ros::Time(0);
+
+        const std::string cmd_vel_topic = index == 0 ? "/pedbot/control/cmd_vel" : "/" + prefix + "/control/cmd_vel";
+        robot->sub_cmd_vel = nh_.subscribe<geometry_msgs::Twist>(cmd_vel_topic, 3,
+            boost::bind(&Simulator::onCmdVel, this, _1, robot.get()));
+        // the first robot is already published on /pedsim/robot_position
+        if (index > 0)
+            robot->pub_odom = nh_.advertise<nav_msgs::Odometry>("/pedsim/" + prefix + "/odom", 1);
+
+        a->setTeleop(true);
+        robots_.push_back(std::move(robot));
+    }
+
+    ROS_INFO_STREAM("Simulating " << robots_.size() << " robot(s) with "
+        << (kinematics_model_ == RobotKinematics::HOLONOMIC ? "holonomic" : "diff drive") << " kinematics");
+}
+
+/// -----------------------------------------------------------------
+/// \brief onCmdVel
+/// \details Store the velocity command of a robot, it is applied in
+/// the next simulation step
+/// -----------------------------------------------------------------
+void Simulator::onCmdVel(const geometry_msgs::Twist::ConstPtr& msg, SimulatedRobot* robot)
+{
+    std::lock_guard<std::mutex> lock(scene_mutex_);
+    robot->kinematics.setCommand(msg->linear.x, msg->linear.y, msg->angular.z);
+    robot->last_command = ros::Time::now();
+}
+
+/// -----------------------------------------------------------------
+/// \brief updateRobots
+/// \details Integrate the velocity commands of all robots over one
+/// time step and move the robot agents, without a TF round trip.
+/// Robots stop when no command arrived for cmd_vel_timeout seconds
+/// -----------------------------------------------------------------
+void Simulator::updateRobots()
+{
+    const ros::Time now = ros::Time::now();
+    const double dt = paused_ ? 0.0 : CONFIG.getTimeStepSize();
+
+    for (auto& robot : robots_) {
+        if (cmd_vel_timeout_ > 0 && (now - robot->last_command).toSec() > cmd_vel_timeout_)
+            robot->kinematics.setCommand(0, 0, 0);
+
+        robot->kinematics.integrate(dt);
+
+        // velocity for the social force of the other agents
+        const Ped::Tvector velocity = dt > 0
+            ? Ped::Tvector(robot->kinematics.getWorldVx(), robot->kinematics.getWorldVy())
+            : Ped::Tvector();
+        robot->agent->setVmax(CONFIG.max_robot_speed);
+        SCENE.relocateAgent(robot->agent,
+            Ped::Tvector(robot->kinematics.getX(), robot->kinematics.getY()), velocity);
+    }
+}
+
+/// -----------------------------------------------------------------
+/// \brief publishRobotOdometry
+/// \details Broadcast the poses of the simulated robots as TF and
+/// odometry (the first robot's odometry is publishRobotPosition)
+/// -----------------------------------------------------------------
+void Simulator::publishRobotOdometry()
+{
+    if (robots_.empty())
+        return;
+
+    const ros::Time now = ros::Time::now();
+    std::vector<tf::StampedTransform> transforms;
+    transforms.reserve(robots_.size());
+
+    for (auto& robot : robots_) {
+        const RobotKinematics& k = robot->kinematics;
+        const tf::Quaternion rotation = tf::createQuaternionFromYaw(k.getTheta());
+        transforms.push_back(tf::StampedTransform(
+            tf::Transform(rotation, tf::Vector3(k.getX(), k.getY(), 0)), now, "odom", robot->frame));
+
+        if (!robot->pub_odom || robot->pub_odom.getNumSubscribers() == 0)
+            continue;
+
+        nav_msgs::OdometryPtr odom(new nav_msgs::Odometry);
+        odom->header.stamp = now;
+        odom->header.frame_id = "odom";
+        odom->child_frame_id = robot->frame;
+        odom->pose.pose.position.x = k.getX();
+        odom->pose.pose.position.y = k.getY();
+        tf::quaternionTFToMsg(rotation, odom->pose.pose.orientation);
+        odom->twist.twist.linear.x = k.getVx();
+        odom->twist.twist.linear.y = k.getVy();
+        odom->twist.twist.angular.z = k.getOmega();
+        robot->pub_odom.publish(odom);
+    }
+
+    transform_broadcaster_->sendTransform(transforms);
+}
+
 /// -----------------------------------------------------------------
 /// \brief publishSocialActivities
 /// \details publish spencer_relation_msgs::SocialActivities
@@ -424,21 +1214,57 @@ void Simulator::publishSocialActivities()
 /// \details publish tracked persons and tracked groups messages
 /// -----------------------------------------------------------------
 void Simulator::publishData()
+{
+    const bool tracked_persons_requested = pub_tracked_persons_.getNumSubscribers() > 0
+        || pub_tracked_persons_full_.getNumSubscribers() > 0
+        || pub_visible_persons_.getNumSubscribers() > 0
+        || pub_tracked_persons_local_.getNumSubscribers() > 0;
+    if (tracked_persons_requested)
+        updateOcclusions();
+
+    // the full messages are heavy, only build them when someone listens
+    if (pub_tracked_persons_.getNumSubscribers() > 0)
+        publishTrackedPersons(getPublishedAgents(), pub_tracked_persons_);
+
+    // loggers still get the whole scene
+    if (aoi_radius_ > 0 && pub_tracked_persons_full_.getNumSubscribers() > 0)
+        publishTrackedPersons(SCENE.getAgents(), pub_tracked_persons_full_);
+
+    if (pub_visible_persons_.getNumSubscribers() > 0)
+        publishTrackedPersons(getPublishedAgents(), pub_visible_persons_, true);
+
+    if (pub_tracked_persons_local_.getNumSubscribers() > 0)
+        publishTrackedPersonsLocal();
+
+    if (pub_tracked_groups_.getNumSubscribers() > 0)
+        publishTrackedGroups();
+}
+
+/// -----------------------------------------------------------------
+/// \brief publishTrackedPersons
+/// \details publish tracked persons in spencer format, optionally
+/// only those not occluded from the robot
+/// -----------------------------------------------------------------
+void Simulator::publishTrackedPersons(const QList<Agent*>& agents, ros::Publisher& publisher,
+    bool visible_only)
 {
     /// Tracked people
-    pedsim_msgs::TrackedPersons tracked_people;
-    std_msgs::Header tracked_people_header;
-    tracked_people_header.stamp = ros::Time::now();
-    tracked_people.header = tracked_people_header;
-    tracked_people.header.frame_id = "odom";
+    // published as shared pointer, nodelets in the same manager get it without a copy
+    pedsim_msgs::TrackedPersonsPtr tracked_people(new pedsim_msgs::TrackedPersons);
+    tracked_people->header.stamp = ros::Time::now();
+    tracked_people->header.frame_id = "odom";
 
-    for (Agent* a : SCENE.getAgents()) {
+    for (Agent* a : agents) {
         if (a->getType() == Ped::Tagent::ROBOT)
             continue;
 
+        const bool occluded = occluded_agents_.count(a->getId()) > 0;
+        if (visible_only && occluded)
+            continue;
+
         pedsim_msgs::TrackedPerson person;
         person.track_id = a->getId();
-        person.is_occluded = false;
+        person.is_occluded = occluded;
         person.detection_id = a->getId();
         // person.age = 0;   // also not simulated yet, use a distribution from data
         // collected
@@ -462,15 +1288,89 @@ void Simulator::publishData()
         tcov.twist.linear.y = a->getvy();
         person.twist = tcov;
 
-        tracked_people.tracks.push_back(person);
+        tracked_people->tracks.push_back(person);
+    }
+
+    publisher.publish(tracked_people);
+}
+
+/// -----------------------------------------------------------------
+/// \brief publishTrackedPersonsLocal
+/// \details publish tracked persons relative to the robot. The robot
+/// pose is known here, so one planar transform is applied to all
+/// positions and velocities instead of TF lookups by every consumer
+/// -----------------------------------------------------------------
+void Simulator::publishTrackedPersonsLocal()
+{
+    if (robot_ == nullptr)
+        return;
+
+    // → gather the states, then transform them in one pass
+    const QList<Agent*>& agents = getPublishedAgents();
+    std::vector<const Agent*> persons;
+    std::vector<double> states; // x, y, vx, vy per person
+    persons.reserve(agents.size());
+    states.reserve(4 * agents.size());
+    for (const Agent* a : agents) {
+        if (a->getType() == Ped::Tagent::ROBOT)
+            continue;
+        persons.push_back(a);
+        states.push_back(a->getx());
+        states.push_back(a->gety());
+        states.push_back(a->getvx());
+        states.push_back(a->getvy());
+    }
+
+    // inverse of the robot pose in the odom frame
+    const double c = cos(robot_heading_), s = sin(robot_heading_);
+    const double rx = robot_->getx(), ry = robot_->gety();
+    const size_t num_persons = persons.size();
+    for (size_t i = 0; i < num_persons; i++) {
+        double* state = &states[4 * i];
+        const double dx = state[0] - rx, dy = state[1] - ry;
+        const double vx = state[2], vy = state[3];
+        state[0] = c * dx + s * dy;
+        state[1] = -s * dx + c * dy;
+        state[2] = c * vx + s * vy;
+        state[3] = -s * vx + c * vy;
+    }
+
+    pedsim_msgs::TrackedPersonsPtr tracked_people(new pedsim_msgs::TrackedPersons);
+    tracked_people->header.stamp = ros::Time::now();
+    tracked_people->header.frame_id = robot_frame_;
+    tracked_people->tracks.resize(num_persons);
+
+    for (size_t i = 0; i < num_persons; i++) {
+        const double* state = &states[4 * i];
+        pedsim_msgs::TrackedPerson& person = tracked_people->tracks[i];
+        person.track_id = persons[i]->getId();
+        person.is_occluded = occluded_agents_.count(persons[i]->getId()) > 0;
+        person.detection_id = persons[i]->getId();
+
+        Eigen::Quaternionf q = orientation_handler_->angle2Quaternion(atan2(state[3], state[2]));
+        person.pose.pose.position.x = state[0];
+        person.pose.pose.position.y = state[1];
+        person.pose.pose.orientation.x = q.x();
+        person.pose.pose.orientation.y = q.y();
+        person.pose.pose.orientation.z = q.z();
+        person.pose.pose.orientation.w = q.w();
+        person.twist.twist.linear.x = state[2];
+        person.twist.twist.linear.y = state[3];
     }
 
+    pub_tracked_persons_local_.publish(tracked_people);
+}
+
+/// -----------------------------------------------------------------
+/// \brief publishTrackedGroups
+/// \details publish tracked groups in spencer format
+/// -----------------------------------------------------------------
+void Simulator::publishTrackedGroups()
+{
     /// Tracked groups
-    pedsim_msgs::TrackedGroups tracked_groups;
-    std_msgs::Header tracked_groups_header;
-    tracked_groups_header.stamp = ros::Time::now();
-    tracked_groups.header = tracked_groups_header;
-    tracked_groups.header.frame_id = "odom";
+    pedsim_msgs::TrackedGroupsPtr tracked_groups(new pedsim_msgs::TrackedGroups);
+    tracked_groups->header.stamp = ros::Time::now();
+    tracked_groups->header.frame_id = "odom";
 
     QList<AgentGroup*> sim_groups = SCENE.getGroups();
     for (AgentGroup* ag : sim_groups) {
@@ -485,14 +1385,111 @@ void Simulator::publishData()
             group.track_ids.push_back(m->getId());
         }
 
-        tracked_groups.groups.push_back(group);
+        tracked_groups->groups.push_back(group);
     }
 
-    /// publish the messages
-    pub_tracked_persons_.publish(tracked_people);
     pub_tracked_groups_.publish(tracked_groups);
 }
 
+/// -----------------------------------------------------------------
+/// \brief publishAgentStatesPacked
+/// \details publish the state of all agents (including robots) as
+/// parallel arrays. Much cheaper to build and serialize than the
+/// tracked persons message, intended for high rate consumers
+/// -----------------------------------------------------------------
+void Simulator::publishAgentStatesPacked()
+{
+    if (pub_agent_states_packed_.getNumSubscribers() == 0)
+        return;
+
+    pedsim_msgs::AgentStatesPackedPtr packed(new pedsim_msgs::AgentStatesPacked);
+    packed->header.stamp = ros::Time::now();
+    packed->header.frame_id = "odom";
+
+    const QList<Agent*>& agents = SCENE.getAgents();
+    reserveAgentStates(*packed, agents.size());
+    for (const Agent* a : agents)
+        appendAgentState(*packed, a);
+
+    pub_agent_states_packed_.publish(packed);
+}
+
+/// -----------------------------------------------------------------
+/// \brief publishAgentStatesDelta
+/// \details publish a full keyframe every delta_keyframe_interval
+/// ticks and in between only the agents whose position, velocity or
+/// state moved away from the last sent values by more than the
+/// thresholds, so bandwidth follows activity rather than crowd size
+/// -----------------------------------------------------------------
+void Simulator::publishAgentStatesDelta()
+{
+    if (pub_agent_states_delta_.getNumSubscribers() == 0) {
+        // new subscribers start from a keyframe
+        delta_sent_states_.clear();
+        delta_ticks_since_keyframe_ = -1;
+        return;
+    }
+
+    const bool keyframe = delta_ticks_since_keyframe_ < 0
+        || delta_ticks_since_keyframe_ + 1 >= delta_keyframe_interval_;
+
+    pedsim_msgs::AgentStatesDeltaPtr delta(new pedsim_msgs::AgentStatesDelta);
+    delta->header.stamp = ros::Time::now();
+    delta->header.frame_id = "odom";
+    delta->states.header = delta->header;
+    delta->sequence = delta_sequence_++;
+    delta->is_keyframe = keyframe;
+
+    const QList<Agent*>& agents = SCENE.getAgents();
+    if (keyframe)
+        reserveAgentStates(delta->states, agents.size());
+
+    // → agents left over in here afterwards have been removed
+    std::unordered_map<int, SentAgentState> previous_states;
+    previous_states.swap(delta_sent_states_);
+    delta_sent_states_.reserve(agents.size());
+
+    for (const Agent* a : agents) {
+        SentAgentState current;
+        current.x = a->getx();
+        current.y = a->gety();
+        current.vx = a->getvx();
+        current.vy = a->getvy();
+        current.state = a->getStateMachine()->getCurrentState();
+
+        auto previous = previous_states.find(a->getId());
+        if (previous == previous_states.end()) {
+            delta->added_ids.push_back(a->getId());
+        }
+        else {
+            const SentAgentState& sent = previous->second;
+            const bool changed = keyframe
+                || std::hypot(current.x - sent.x, current.y - sent.y) > delta_position_threshold_
+                || std::hypot(current.vx - sent.vx, current.vy - sent.vy) > delta_velocity_threshold_
+                || current.state != sent.state;
+
+            previous_states.erase(previous);
+
+            // keep comparing against what the receivers know
+            if (!changed) {
+                delta_sent_states_[a->getId()] = sent;
+                continue;
+            }
+        }
+
+        appendAgentState(delta->states, a);
+        delta_sent_states_[a->getId()] = current;
+    }
+
+    // whatever was not visited has left the scene
+    for (const auto& removed : previous_states)
+        delta->removed_ids.push_back(removed.first);
+
+    delta_ticks_since_keyframe_ = keyframe ? 0 : delta_ticks_since_keyframe_ + 1;
+
+    pub_agent_states_delta_.publish(delta);
+}
+
 /// -----------------------------------------------------------------
 /// \brief publishRobotPosition
 /// \details publish the robot position for use in navigation related
@@ -545,7 +1542,12 @@ void Simulator::publishAgents()
     all_header.stamp = ros::Time::now();
     all_status.header = all_header;
 
-    for (Agent* a : SCENE.getAgents()) {
+    // markers of agents leaving the area of interest have to expire
+    const ros::Duration lifetime = aoi_radius_ > 0
+        ? ros::Duration(2.0 / CONFIG.updateRate)
+        : ros::Duration(0);
+
+    for (Agent* a : getPublishedAgents()) {
         /// walking people message
         animated_marker_msgs::AnimatedMarker marker;
         marker.mesh_use_embedded_materials = true;
@@ -561,12 +1563,14 @@ void Simulator::publishAgents()
         marker.scale.x = PERSON_MESH_SCALE;
         marker.scale.y = PERSON_MESH_SCALE;
         marker.scale.z = PERSON_MESH_SCALE;
+        marker.lifetime = lifetime;
 
         /// arrows
         visualization_msgs::Marker arrow;
         arrow.header.frame_id = "odom";
         arrow.header.stamp = ros::Time();
         arrow.id = a->getId() + 3000;
+        arrow.lifetime = lifetime;
 
         arrow.pose.position.x = a->getx();
         arrow.pose.position.y = a->gety();
@@ -640,33 +1644,14 @@ void Simulator::publishAgents()
             marker_array.markers.push_back(marker);
         if (publishArrow)
             arrow_array.markers.push_back(arrow);
-
-        /// status message
-        /// TODO - remove this once, we publish internal states using
-        /// spencer messages
-        pedsim_msgs::AgentState state;
-        std_msgs::Header agent_header;
-        agent_header.stamp = ros::Time::now();
-        state.header = agent_header;
-
-        state.id = a->getId();
-        state.type = a->getType();
-        state.pose.position.x = a->getx();
-        state.pose.position.y = a->gety();
-        state.pose.position.z = a->getz();
-
-        state.twist.linear.x = a->getvx();
-        state.twist.linear.y = a->getvy();
-        state.twist.linear.z = a->getvz();
-
-        AgentStateMachine::AgentState sc = a->getStateMachine()->getCurrentState();
-        state.social_state = agentStateToActivity(sc);
-        if (a->getType() == Ped::Tagent::ELDER)
-            state.social_state = pedsim_msgs::AgentState::TYPE_STANDING;
-
-        all_status.agent_states.push_back(state);
     }
 
+    /// status message, always of the full scene since loggers use it
+    /// TODO - remove this once, we publish internal states using
+    /// spencer messages
+    for (Agent* a : SCENE.getAgents())
+        all_status.agent_states.push_back(agentToState(a));
+
     // publish the marker array
     pub_agent_visuals_.publish(marker_array);
     pub_agent_arrows_.publish(arrow_array);
@@ -724,36 +1709,253 @@ void Simulator::publishGroupVisuals()
     }
 }
 
+/// -----------------------------------------------------------------
+/// \brief publishLaserScan
+/// \details Simulate a laser scanner at the robot pose, seeing walls
+/// and the agents around the robot, at the configured rate
+/// -----------------------------------------------------------------
+void Simulator::publishLaserScan()
+{
+    if (!laser_scanner_ || robot_ == nullptr)
+        return;
+    if (SCENE.getTime() < laser_next_scan_time_)
+        return;
+    laser_next_scan_time_ = SCENE.getTime() + laser_period_;
+
+    // → walls only change with the obstacles
+    if (laser_walls_revision_ != SCENE.obstacle_cells_revision_) {
+        std::vector<LaserScanner::Segment> walls;
+        walls.reserve(SCENE.getObstacles().size());
+        for (const Obstacle* obstacle : SCENE.getObstacles())
+            walls.push_back({ obstacle->getax(), obstacle->getay(), obstacle->getbx(), obstacle->getby() });
+        laser_scanner_->setWalls(walls);
+        laser_walls_revision_ = SCENE.obstacle_cells_revision_;
+    }
+
+    // → agents in range of the sensor
+    const double x = robot_->getx(), y = robot_->gety();
+    std::set<const Ped::Tagent*> neighbors = SCENE.getNeighbors(x, y, laser_scanner_->getRangeMax() + 1.0);
+    std::vector<LaserScanner::Circle> agents;
+    agents.reserve(neighbors.size());
+    for (const Ped::Tagent* neighbor : neighbors) {
+        if (neighbor != robot_)
+            agents.push_back({ neighbor->getx(), neighbor->gety(), neighbor->getRadius() });
+    }
+
+    sensor_msgs::LaserScanPtr scan(new sensor_msgs::LaserScan);
+    scan->header.stamp = ros::Time::now();
+    scan->header.frame_id = laser_frame_;
+    scan->angle_min = laser_scanner_->getAngleMin();
+    scan->angle_max = laser_scanner_->getAngleMin()
+        + (laser_scanner_->getNumBeams() - 1) * laser_scanner_->getAngleIncrement();
+    scan->angle_increment = laser_scanner_->getAngleIncrement();
+    scan->scan_time = laser_period_;
+    scan->range_min = 0.0;
+    scan->range_max = laser_scanner_->getRangeMax();
+    laser_scanner_->scan(x, y, robot_heading_, agents, scan->ranges);
+
+    pub_laser_scan_.publish(scan);
+}
+
+/// -----------------------------------------------------------------
+/// \brief publishDetectedPersons
+/// \details Simulate a people detector at the robot pose. Candidates
+/// come from a range query around the robot, the detections are
+/// relative to the robot. The rate is bounded by the simulation rate
+/// -----------------------------------------------------------------
+void Simulator::publishDetectedPersons()
+{
+    if (!people_detector_ || robot_ == nullptr)
+        return;
+    if (SCENE.getTime() < detector_next_time_)
+        return;
+    detector_next_time_ = SCENE.getTime() + detector_period_;
+
+    const double x = robot_->getx(), y = robot_->gety();
+    std::set<const Ped::Tagent*> neighbors = SCENE.getNeighbors(x, y, people_detector_->getRangeMax());
+    std::vector<PeopleDetector::Person> persons;
+    persons.reserve(neighbors.size());
+    for (const Ped::Tagent* neighbor : neighbors) {
+        if (neighbor->getType() != Ped::Tagent::ROBOT)
+            persons.push_back({ neighbor->getId(), neighbor->getx(), neighbor->gety() });
+    }
+
+    std::vector<PeopleDetector::Detection> detections;
+    people_detector_->detect(x, y, robot_heading_, persons, RNG(), detections);
+
+    pedsim_msgs::DetectedPersonsPtr msg(new pedsim_msgs::DetectedPersons);
+    msg->header.stamp = ros::Time::now();
+    msg->header.frame_id = detector_frame_;
+    msg->detections.reserve(detections.size());
+
+    const double variance = std::max(people_detector_->getPositionNoise() * people_detector_->getPositionNoise(), 1e-4);
+    for (const PeopleDetector::Detection& detection : detections) {
+        pedsim_msgs::DetectedPerson person;
+        person.detection_id = detection_id_counter_++;
+        person.confidence = detection.confidence;
+        person.modality = "pedsim";
+        person.pose.pose.position.x = detection.x;
+        person.pose.pose.position.y = detection.y;
+        person.pose.pose.orientation.w = 1.0;
+
+        // → only the planar position is measured
+        person.pose.covariance[0] = variance;
+        person.pose.covariance[7] = variance;
+        for (int i = 2; i < 6; i++)
+            person.pose.covariance[i * 6 + i] = 99999.0;
+
+        msg->detections.push_back(person);
+    }
+
+    pub_detected_persons_.publish(msg);
+}
+
+/// -----------------------------------------------------------------
+/// \brief updateCrowdGrid
+/// \details Every tick, agents that changed their cell are moved in
+/// the raster, the rest only update their velocity contribution
+/// -----------------------------------------------------------------
+void Simulator::updateCrowdGrid()
+{
+    if (!crowd_grid_)
+        return;
+
+    crowd_grid_->beginUpdate();
+    for (const Agent* a : SCENE.getAgents()) {
+        if (a->getType() != Ped::Tagent::ROBOT)
+            crowd_grid_->update(a->getId(), a->getx(), a->gety(), a->getvx(), a->getvy());
+    }
+    crowd_grid_->endUpdate(); // drops removed agents
+}
+
+/// -----------------------------------------------------------------
+/// \brief fillCrowdGrid
+/// \details Copy a window of the crowd raster into the messages,
+/// cells outside the raster are reported empty
+/// -----------------------------------------------------------------
+void Simulator::fillCrowdGrid(int x0, int y0, int width, int height,
+    nav_msgs::OccupancyGrid& density, pedsim_msgs::CrowdGrid& grid)
+{
+    const double resolution = crowd_grid_->getResolution();
+
+    nav_msgs::MapMetaData info;
+    info.map_load_time = ros::Time::now();
+    info.resolution = resolution;
+    info.width = width;
+    info.height = height;
+    info.origin.position.x = crowd_grid_->getOriginX() + x0 * resolution;
+    info.origin.position.y = crowd_grid_->getOriginY() + y0 * resolution;
+    info.origin.orientation.w = 1.0;
+
+    density.header.stamp = info.map_load_time;
+    density.header.frame_id = "odom";
+    density.info = info;
+    density.data.assign(width * height, 0);
+
+    grid.header = density.header;
+    grid.info = info;
+    grid.density.assign(width * height, 0.0f);
+    grid.vx.assign(width * height, 0.0f);
+    grid.vy.assign(width * height, 0.0f);
+
+    const int y_begin = std::max(y0, 0), y_end = std::min(y0 + height, crowd_grid_->getHeight());
+    const int x_begin = std::max(x0, 0), x_end = std::min(x0 + width, crowd_grid_->getWidth());
+    for (int y = y_begin; y < y_end; y++) {
+        for (int x = x_begin; x < x_end; x++) {
+            const int cell = y * crowd_grid_->getWidth() + x;
+            if (crowd_grid_->getCount(cell) == 0)
+                continue;
+
+            const int target = (y - y0) * width + (x - x0);
+            const double d = crowd_grid_->getDensity(cell);
+            density.data[target] = static_cast<int8_t>(std::min(100.0, 100.0 * d / crowd_grid_max_density_));
+            grid.density[target] = d;
+            grid.vx[target] = crowd_grid_->getMeanVx(cell);
+            grid.vy[target] = crowd_grid_->getMeanVy(cell);
+        }
+    }
+}
+
+/// -----------------------------------------------------------------
+/// \brief publishCrowdGrid
+/// \details publish the density and velocity raster of the whole
+/// scene (latched) and a crop centered at the robot, at the
+/// configured rate and only if someone listens
+/// -----------------------------------------------------------------
+void Simulator::publishCrowdGrid()
+{
+    if (!crowd_grid_)
+        return;
+    if (SCENE.getTime() < crowd_grid_next_time_)
+        return;
+    crowd_grid_next_time_ = SCENE.getTime() + crowd_grid_period_;
+
+    if (pub_crowd_density_.getNumSubscribers() > 0 || pub_crowd_grid_.getNumSubscribers() > 0) {
+        nav_msgs::OccupancyGridPtr density(new nav_msgs::OccupancyGrid);
+        pedsim_msgs::CrowdGridPtr grid(new pedsim_msgs::CrowdGrid);
+        fillCrowdGrid(0, 0, crowd_grid_->getWidth(), crowd_grid_->getHeight(), *density, *grid);
+        pub_crowd_density_.publish(density);
+        pub_crowd_grid_.publish(grid);
+    }
+
+    if (robot_ != nullptr
+        && (pub_crowd_density_local_.getNumSubscribers() > 0 || pub_crowd_grid_local_.getNumSubscribers() > 0)) {
+        // → window aligned to the raster cells
+        const double resolution = crowd_grid_->getResolution();
+        const int size = std::max(1, static_cast<int>(std::ceil(crowd_grid_local_size_ / resolution)));
+        const int x0 = static_cast<int>(std::floor((robot_->getx() - crowd_grid_->getOriginX()) / resolution)) - size / 2;
+        const int y0 = static_cast<int>(std::floor((robot_->gety() - crowd_grid_->getOriginY()) / resolution)) - size / 2;
+
+        nav_msgs::OccupancyGridPtr density(new nav_msgs::OccupancyGrid);
+        pedsim_msgs::CrowdGridPtr grid(new pedsim_msgs::CrowdGrid);
+        fillCrowdGrid(x0, y0, size, size, *density, *grid);
+        pub_crowd_density_local_.publish(density);
+        pub_crowd_grid_local_.publish(grid);
+    }
+}
+
 /// -----------------------------------------------------------------
 /// \brief publishObstacles
 /// \details publish obstacle cells with information about their
 /// positions and cell sizes. Useful for path planning.
+/// \note The topic is latched, so the message is only rebuilt and
+/// sent again when the obstacle cells change
 /// -----------------------------------------------------------------
 void Simulator::publishObstacles()
 {
-    nav_msgs::GridCells grid_cells;
-    grid_cells.header.frame_id = "odom";
-    grid_cells.cell_width = CONFIG.cell_width;
-    grid_cells.cell_height = CONFIG.cell_height;
+    if (obstacles_revision_ == SCENE.obstacle_cells_revision_)
+        return;
+
+    nav_msgs::GridCellsPtr grid_cells(new nav_msgs::GridCells);
+    grid_cells->header.stamp = ros::Time::now();
+    grid_cells->header.frame_id = "odom";
+    grid_cells->cell_width = CONFIG.cell_width;
+    grid_cells->cell_height = CONFIG.cell_height;
+    grid_cells->cells.reserve(SCENE.obstacle_cells_.size());
 
     for (const auto& obstacle : SCENE.obstacle_cells_) {
         geometry_msgs::Point p;
         p.x = obstacle.x;
         p.y = obstacle.y;
         p.z = 0.0;
-        grid_cells.cells.push_back(p);
+        grid_cells->cells.push_back(p);
     }
 
     pub_obstacles_.publish(grid_cells);
+    obstacles_revision_ = SCENE.obstacle_cells_revision_;
 }
 
 /// -----------------------------------------------------------------
 /// \brief publishWalls
 /// \details publish visual markers for obstacle given as 3D cells
 /// for visualizing in rviz. Useful for visual plan inspection
+/// \note Latched like the obstacle cells, only resent on changes
 /// -----------------------------------------------------------------
 void Simulator::publishWalls()
 {
+    if (walls_revision_ == SCENE.obstacle_cells_revision_)
+        return;
+
     visualization_msgs::Marker marker;
     marker.header.frame_id = "odom";
     marker.header.stamp = ros::Time();
@@ -767,6 +1969,7 @@ void Simulator::publishWalls()
     marker.scale.z = 2.0;
     marker.pose.position.z = marker.scale.z / 2.0;
     marker.type = visualization_msgs::Marker::CUBE_LIST;
+    marker.points.reserve(SCENE.obstacle_cells_.size());
 
     for (const auto& obstacle : SCENE.obstacle_cells_) {
         geometry_msgs::Point p;
@@ -777,6 +1980,7 @@ void Simulator::publishWalls()
     }
 
     pub_walls_.publish(marker);
+    walls_revision_ = SCENE.obstacle_cells_revision_;
 }
 
 /// -----------------------------------------------------------------
@@ -850,6 +2054,65 @@ Eigen::Quaternionf Simulator::computePose(Agent* a)
     return q;
 }
 
+/// -----------------------------------------------------------------
+/// \brief agentToState
+/// \details convert an agent into the (old) agent state message
+/// -----------------------------------------------------------------
+pedsim_msgs::AgentState Simulator::agentToState(const Agent* a)
+{
+    pedsim_msgs::AgentState state;
+    state.header.stamp = ros::Time::now();
+
+    state.id = a->getId();
+    state.type = a->getType();
+    state.pose.position.x = a->getx();
+    state.pose.position.y = a->gety();
+    state.pose.position.z = a->getz();
+
+    state.twist.linear.x = a->getvx();
+    state.twist.linear.y = a->getvy();
+    state.twist.linear.z = a->getvz();
+
+    AgentStateMachine::AgentState sc = a->getStateMachine()->getCurrentState();
+    state.social_state = agentStateToActivity(sc);
+    if (a->getType() == Ped::Tagent::ELDER)
+        state.social_state = pedsim_msgs::AgentState::TYPE_STANDING;
+
+    return state;
+}
+
+/// -----------------------------------------------------------------
+/// \brief reserveAgentStates
+/// \details reserve space for a number of agents in all the arrays
+/// of a packed states message
+/// -----------------------------------------------------------------
+void Simulator::reserveAgentStates(pedsim_msgs::AgentStatesPacked& packed, size_t num_agents)
+{
+    packed.ids.reserve(num_agents);
+    packed.x.reserve(num_agents);
+    packed.y.reserve(num_agents);
+    packed.vx.reserve(num_agents);
+    packed.vy.reserve(num_agents);
+    packed.type.reserve(num_agents);
+    packed.state.reserve(num_agents);
+}
+
+/// -----------------------------------------------------------------
+/// \brief appendAgentState
+/// \details append the state of an agent to a packed states message
+/// -----------------------------------------------------------------
+void Simulator::appendAgentState(pedsim_msgs::AgentStatesPacked& packed, const Agent* a)
+{
+    packed.ids.push_back(a->getId());
+    packed.x.push_back(a->getx());
+    packed.y.push_back(a->gety());
+    packed.vx.push_back(a->getvx());
+    packed.vy.push_back(a->getvy());
+    packed.type.push_back(a->getType());
+    // the message constants mirror the state machine values
+    packed.state.push_back(a->getStateMachine()->getCurrentState());
+}
+
 /// -----------------------------------------------------------------
 /// \brief Convert agent state machine state to simulated activity
 /// -----------------------------------------------------------------
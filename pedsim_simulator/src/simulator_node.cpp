@@ -29,30 +29,28 @@
 */
 
 #include <QApplication>
-#include <signal.h>
 
-#include <pedsim_simulator/simulator.h>
+#include <nodelet/loader.h>
+#include <ros/ros.h>
 
+/// Standalone wrapper, loads the simulator nodelet into this process
 int main(int argc, char** argv)
 {
     QApplication app(argc, argv);
 
     // initialize resources
     ros::init(argc, argv, "simulator");
-    ros::NodeHandle node;
-    Simulator sm(node);
 
-    // use default SIGINT handler so CTRL+C works
-    signal(SIGINT, SIG_DFL);
-
-    if (sm.initializeSimulation()) {
-        ROS_INFO("node initialized, now running ");
-
-        sm.runSimulation();
-    } else {
-        ROS_WARN("Could not initialize simulation, aborting");
+    nodelet::Loader loader;
+    nodelet::M_string remappings(ros::names::getRemappings());
+    nodelet::V_string nodelet_argv;
+    if (!loader.load(ros::this_node::getName(), "pedsim_simulator/SimulatorNodelet",
+            remappings, nodelet_argv)) {
+        ROS_WARN("Could not load the simulator nodelet, aborting");
         return EXIT_FAILURE;
     }
 
-    return app.exec();
+    ros::spin();
+
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,123 @@
+/**
+* Copyright 2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <QCoreApplication>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <pedsim_simulator/simulator.h>
+
+namespace pedsim_simulator {
+
+/// -----------------------------------------------------------------
+/// \class SimulatorNodelet
+/// \brief Runs the simulator inside a nodelet manager
+/// \details The simulation loop gets its own thread, the ROS callbacks
+/// (services, dynamic reconfigure) are served by the manager. Consumers
+/// loaded into the same manager receive the published messages without
+/// serialization. Only one simulator per process, the scene is a
+/// singleton.
+///
+/// The simulator is created and initialized in the simulation thread.
+/// No thread runs a Qt event loop, the scene elements have to live in
+/// the thread that emits their signals so that the connections are
+/// direct ones.
+/// -----------------------------------------------------------------
+class SimulatorNodelet : public nodelet::Nodelet {
+public:
+    SimulatorNodelet()
+        : app_argc_(0)
+        , simulator_(nullptr)
+        , shutting_down_(false)
+    {
+    }
+
+    virtual ~SimulatorNodelet()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutting_down_ = true;
+            if (simulator_ != nullptr)
+                simulator_->stopSimulation();
+        }
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+private:
+    virtual void onInit()
+    {
+        // the scene elements are QObjects, make sure there is an application
+        if (QCoreApplication::instance() == nullptr)
+            app_.reset(new QCoreApplication(app_argc_, nullptr));
+
+        thread_ = std::thread(&SimulatorNodelet::run, this);
+    }
+
+    void run()
+    {
+        Simulator simulator(getNodeHandle(), getPrivateNodeHandle());
+        if (!simulator.initializeSimulation()) {
+            NODELET_ERROR("Could not initialize simulation, aborting");
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shutting_down_)
+                return;
+            simulator_ = &simulator;
+        }
+
+        NODELET_INFO("nodelet initialized, now running");
+        simulator.runSimulation();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        simulator_ = nullptr;
+    }
+
+    int app_argc_;
+    std::unique_ptr<QCoreApplication> app_;
+    std::thread thread_;
+
+    // → the simulator while it runs, guarded by mutex_
+    std::mutex mutex_;
+    Simulator* simulator_;
+    bool shutting_down_;
+};
+
+} // namespace pedsim_simulator
+
+PLUGINLIB_EXPORT_CLASS(pedsim_simulator::SimulatorNodelet, nodelet::Nodelet)
@@ -41,11 +41,10 @@ QueueingWaypointPlanner::QueueingWaypointPlanner()
     agent = nullptr;
     waitingQueue = nullptr;
     currentWaypoint = nullptr;
-    followedAgent = nullptr;
     status = QueueingWaypointPlanner::Unknown;
 }
 
-void QueueingWaypointPlanner::onFollowedAgentPositionChanged(double xIn, double yIn)
+void QueueingWaypointPlanner::setQueueingPosition(const Ped::Tvector& positionIn, bool force)
 {
     // sanity checks
     if (currentWaypoint == nullptr) {
@@ -53,50 +52,26 @@ void QueueingWaypointPlanner::onFollowedAgentPositionChanged(double xIn, double
         return;
     }
 
-    Ped::Tvector followedPosition(xIn, yIn);
-    addPrivateSpace(followedPosition);
-
     //HACK: don't update minor changes (prevent over-correcting)
     //TODO: integrate update importance to waypoint (force?)
     const double minUpdateDistance = 0.7;
-    Ped::Tvector diff = followedPosition - currentWaypoint->getPosition();
-    if (diff.length() < minUpdateDistance)
+    Ped::Tvector diff = positionIn - currentWaypoint->getPosition();
+    if (!force && (diff.length() < minUpdateDistance))
         return;
 
-    currentWaypoint->setPosition(followedPosition);
+    currentWaypoint->setPosition(positionIn);
 }
 
-void QueueingWaypointPlanner::onAgentMayPassQueue(int id)
+void QueueingWaypointPlanner::onMayPass()
 {
-    // check who will leave queue
-    if ((agent != nullptr) && (id == agent->getId())) {
-        // the agent may pass
-        // → update waypoint
-        status = QueueingWaypointPlanner::MayPass;
-
-        // remove references to old queue
-        disconnect(waitingQueue, SIGNAL(agentMayPass(int)),
-            this, SLOT(onAgentMayPassQueue(int)));
-        disconnect(waitingQueue, SIGNAL(queueEndPositionChanged(double, double)),
-            this, SLOT(onQueueEndPositionChanged(double, double)));
-    }
-    else if ((followedAgent != nullptr) && (id == followedAgent->getId())) {
-        // followed agent leaves queue
-        onFollowedAgentLeftQueue();
-    }
+    // the agent may pass
+    // → update waypoint
+    status = QueueingWaypointPlanner::MayPass;
 }
 
-void QueueingWaypointPlanner::onFollowedAgentLeftQueue()
+bool QueueingWaypointPlanner::isApproaching() const
 {
-    // followed agent leaves queue
-    // → remove all connections to old followed agent
-    disconnect(followedAgent, SIGNAL(positionChanged(double, double)),
-        this, SLOT(onFollowedAgentPositionChanged(double, double)));
-
-    // → move to queue's front
-    //HACK: actually we have to check our position and eventually bind to a new followed agent
-    Ped::Tvector queueingPosition = waitingQueue->getPosition();
-    currentWaypoint->setPosition(queueingPosition);
+    return (status == QueueingWaypointPlanner::Approaching);
 }
 
 void QueueingWaypointPlanner::onQueueEndPositionChanged(double xIn, double yIn)
@@ -124,23 +99,18 @@ void QueueingWaypointPlanner::onQueueEndPositionChanged(double xIn, double yIn)
 
 void QueueingWaypointPlanner::reset()
 {
-    // disconnect signals
-    if (followedAgent != nullptr) {
-        disconnect(followedAgent, SIGNAL(positionChanged(double, double)),
-            this, SLOT(onFollowedAgentPositionChanged(double, double)));
-    }
+    // leave the old queue
     if (waitingQueue != nullptr) {
-        disconnect(waitingQueue, SIGNAL(agentMayPass(int)),
-            this, SLOT(onAgentMayPassQueue(int)));
-        disconnect(waitingQueue, SIGNAL(queueEndPositionChanged(double, double)),
-            this, SLOT(onQueueEndPositionChanged(double, double)));
+        if (status == QueueingWaypointPlanner::Queued)
+            waitingQueue->dequeueAgent(agent);
+        else if (status == QueueingWaypointPlanner::Approaching)
+            waitingQueue->removeApproachingPlanner(this);
     }
 
     // unset variables
     status = QueueingWaypointPlanner::Unknown;
     delete currentWaypoint;
     currentWaypoint = nullptr;
-    followedAgent = nullptr;
 }
 
 Agent* QueueingWaypointPlanner::getAgent() const
@@ -178,11 +148,8 @@ void QueueingWaypointPlanner::setWaitingQueue(WaitingQueue* queueIn)
     waitingQueue = queueIn;
     if (waitingQueue != nullptr) {
         status = QueueingWaypointPlanner::Approaching;
-        // connect signals
-        connect(waitingQueue, SIGNAL(agentMayPass(int)),
-            this, SLOT(onAgentMayPassQueue(int)));
-        connect(waitingQueue, SIGNAL(queueEndPositionChanged(double, double)),
-            this, SLOT(onQueueEndPositionChanged(double, double)));
+        // follow the queue end until enqueued
+        waitingQueue->addApproachingPlanner(this);
     }
 }
 
@@ -212,6 +179,7 @@ void QueueingWaypointPlanner::activateApproachingMode()
 {
     // update mode
     status = QueueingWaypointPlanner::Approaching;
+    waitingQueue->addApproachingPlanner(this);
 
     // set new waypoint
     QString waypointName = createWaypointName();
@@ -219,7 +187,9 @@ void QueueingWaypointPlanner::activateApproachingMode()
 
     // reset waypoint (remove old one)
     delete currentWaypoint;
-    currentWaypoint = new QueueingWaypoint(waypointName, destination);
+    QueueingWaypoint* queueingWaypoint = new QueueingWaypoint(waypointName, destination);
+    queueingWaypoint->setRoutingWaypoint(waitingQueue);
+    currentWaypoint = queueingWaypoint;
 
     // NOTE - wild experiment
     agent->disableForce("GroupCoherence");
@@ -234,19 +204,8 @@ void QueueingWaypointPlanner::activateQueueingMode()
 
     // set new waypoint
     QString waypointName = createWaypointName();
-    Ped::Tvector queueingPosition;
-    followedAgent = waitingQueue->enqueueAgent(agent);
-    if (followedAgent != nullptr) {
-        queueingPosition = followedAgent->getPosition();
-        addPrivateSpace(queueingPosition);
-
-        // keep updating the waypoint
-        connect(followedAgent, SIGNAL(positionChanged(double, double)),
-            this, SLOT(onFollowedAgentPositionChanged(double, double)));
-    }
-    else {
-        queueingPosition = waitingQueue->getPosition();
-    }
+    // → the queue keeps updating the waypoint
+    Ped::Tvector queueingPosition = waitingQueue->enqueueAgent(agent, this);
 
     // deactivate problematic forces
     agent->disableForce("Social"); /// Uncomment to enable chaotic queues mode
@@ -257,21 +216,18 @@ void QueueingWaypointPlanner::activateQueueingMode()
 
     // reset waypoint (remove old one)
     delete currentWaypoint;
-    currentWaypoint = new QueueingWaypoint(waypointName, queueingPosition);
+    QueueingWaypoint* queueingWaypoint = new QueueingWaypoint(waypointName, queueingPosition);
+    queueingWaypoint->setRoutingWaypoint(waitingQueue);
+    currentWaypoint = queueingWaypoint;
 }
 
 /// Affects the behavior at the end of the queue and hence the shape
 void QueueingWaypointPlanner::addPrivateSpace(Ped::Tvector& queueEndIn) const
 {
-    std::uniform_real_distribution<double> spacing_range_(0.2, 0.8);
-    std::uniform_real_distribution<double> heading_range_(-45.0, 45.0);
-
-    // randomize spacing and heading in queues
-    double privateSpaceDirection = heading_range_(RNG());
+    double privateSpaceDistance;
     Ped::Tangle orientation;
-    orientation.setDegree(privateSpaceDirection);
+    waitingQueue->drawPrivateSpace(privateSpaceDistance, orientation);
 
-    double privateSpaceDistance = spacing_range_(RNG());
     Ped::Tvector queueOffset(Ped::Tvector::fromPolar(waitingQueue->getDirection() + orientation, privateSpaceDistance));
     queueEndIn -= queueOffset;
 }
@@ -45,6 +45,13 @@ ShoppingPlanner::ShoppingPlanner()
     currentWaypoint = nullptr;
     attraction = nullptr;
     timeReached = 0;
+    dwellEvent = 0;
+    dwellCompleted = false;
+}
+
+ShoppingPlanner::~ShoppingPlanner()
+{
+    SCENE.cancelEvent ( dwellEvent );
 }
 
 void ShoppingPlanner::loseAttraction()
@@ -53,7 +60,7 @@ void ShoppingPlanner::loseAttraction()
     delete currentWaypoint;
     currentWaypoint = nullptr;
     attraction = nullptr;
-    timeReached = 0;
+    resetDwellTime();
 
     // inform users
     emit lostAttraction();
@@ -90,6 +97,7 @@ bool ShoppingPlanner::setAttraction ( AttractionArea* attractionIn )
     // reset waypoint
     delete currentWaypoint;
     currentWaypoint = nullptr;
+    resetDwellTime();
 
     return true;
 }
@@ -107,25 +115,39 @@ bool ShoppingPlanner::hasCompletedWaypoint()
     if ( currentWaypoint == nullptr )
         return true;
 
-    // check whether agent has reached the waypoint and has been there for a given time
+    // agent has been at the waypoint for the given time
+    if ( dwellCompleted )
+        return true;
+
+    // still waiting there, the dwell event will tell
+    if ( dwellEvent != 0 )
+        return false;
+
+    // check whether agent has reached the waypoint
     const double distanceThreshold = 1.0;
     // TODO - make shopping time also random
     const double waitTime = 15.0;
     double distance = ( agent->getPosition() - currentWaypoint->getPosition() ).length();
     if ( distance <= distanceThreshold )
     {
-        double sceneTime = SCENE.getTime();
-        if ( timeReached == 0 )
-            timeReached = sceneTime;
-        else if ( timeReached - sceneTime >= waitTime )
-        {
-            return true;
-        }
+        timeReached = SCENE.getTime();
+        dwellEvent = SCENE.scheduleEvent ( timeReached + waitTime, [this]() {
+            dwellEvent = 0;
+            dwellCompleted = true;
+        } );
     }
 
     return false;
 }
 
+void ShoppingPlanner::resetDwellTime()
+{
+    SCENE.cancelEvent ( dwellEvent );
+    dwellEvent = 0;
+    dwellCompleted = false;
+    timeReached = 0;
+}
+
 bool ShoppingPlanner::hasCompletedDestination() const
 {
     // Note: The shopping planner is never done.
@@ -165,7 +187,7 @@ Waypoint* ShoppingPlanner::getNextWaypoint()
     currentWaypoint = new AreaWaypoint ( name, position, 0.5 );
 
     // reset reached time
-    timeReached = 0;
+    resetDwellTime();
 
     // remove previous waypoint
     delete oldWaypoint;
@@ -0,0 +1,81 @@
+/**
+* Copyright 2014-2016 Social Robotics Lab, University of Freiburg
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*    # Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*    # Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*    # Neither the name of the University of Freiburg nor the names of its
+*       contributors may be used to endorse or promote products derived from
+*       this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* \author Billy Okal <okal@cs.uni-freiburg.de>
+*/
+
+#include <pedsim_simulator/navigation/flowfield.h>
+#include <pedsim_simulator/navigation/obstaclemap.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace {
+// wall between the query points and the goal, the path around each
+// end is equally long on the line y = 0
+class FlowFieldSplitTest : public ::testing::Test {
+protected:
+    void SetUp()
+    {
+        std::vector<Router::Segment> walls = { { 0, -5, 0, 5 } };
+        map_.build(walls, -10, -10, 10, 10, 0.25, 0.3);
+        field_.compute(map_, 5, 0, 0.5);
+    }
+
+    ObstacleMap map_;
+    FlowField field_;
+};
+}
+
+TEST_F(FlowFieldSplitTest, DoesNotPointIntoTheWallWherePathsSplit)
+{
+    for (const double y : { 0.0, 0.01, -0.01 }) {
+        double dx, dy, distance;
+        ASSERT_TRUE(field_.lookup(map_, -1, y, dx, dy, distance));
+
+        // → around one of the wall ends, not straight through
+        EXPECT_GT(std::fabs(dy), 0.9) << "at y = " << y;
+        EXPECT_NEAR(std::hypot(dx, dy), 1.0, 1e-6);
+    }
+}
+
+TEST_F(FlowFieldSplitTest, BlendsAwayFromTheSplit)
+{
+    double dx, dy, distance;
+    ASSERT_TRUE(field_.lookup(map_, -1, 2, dx, dy, distance));
+    EXPECT_GT(dy, 0.9);
+
+    ASSERT_TRUE(field_.lookup(map_, -1, -2, dx, dy, distance));
+    EXPECT_LT(dy, -0.9);
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
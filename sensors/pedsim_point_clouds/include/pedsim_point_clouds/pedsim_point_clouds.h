@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) Social Robotics Laboratory
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \author Billy Okal <okal@cs.uni-freiburg.de>
+ */
+
+#ifndef PEDSIM_POINT_CLOUDS_H
+#define PEDSIM_POINT_CLOUDS_H
+
+#include <tf/transform_listener.h> // must come first due to conflict with Boost signals
+
+/// ros
+#include <ros/ros.h>
+
+/// meta
+#include <array>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+
+/// data
+#include <sensor_msgs/PointCloud2.h>
+#include <nav_msgs/GridCells.h>
+#include <nav_msgs/Odometry.h>
+#include <geometry_msgs/Point.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <pedsim_msgs/AgentStatesPacked.h>
+#include <pedsim_msgs/TrackedPersons.h>
+
+#include <pedsim_point_clouds/point_grid.h>
+
+/// -----------------------------------------------------------
+/// \class PedsimCloud
+/// \brief Receives data from pedsim containing obstacles and
+/// persons and published it as point clouds
+/// -----------------------------------------------------------
+class PedsimCloud {
+public:
+    explicit PedsimCloud(const ros::NodeHandle& node)
+        : nh_(node)
+    {
+        // people are read either from the compact agent states or the tracked persons
+        bool use_packed_states;
+        nh_.param("/pedsim_point_clouds/use_packed_states", use_packed_states, false);
+
+        // set up subscribers
+        sub_grid_cells_ = nh_.subscribe("/pedsim/static_obstacles", 1, &PedsimCloud::callbackGridCells, this);
+        if (use_packed_states)
+            sub_tracked_persons_ = nh_.subscribe("/pedsim/agent_states_packed", 1, &PedsimCloud::callbackAgentStatesPacked, this);
+        else
+            sub_tracked_persons_ = nh_.subscribe("/pedsim/tracked_persons", 1, &PedsimCloud::callbackTrackedPersons, this);
+        sub_robot_odom_ = nh_.subscribe("/pedsim/robot_position", 1, &PedsimCloud::callbackRobotOdom, this);
+
+        // set up publishers
+        // publisher for static obstacles as point clouds (the global one only changes with the map)
+        pub_point_cloud_global_ = nh_.advertise<sensor_msgs::PointCloud2>("/pedsim/obstacle_cloud_global", 1, true);
+        pub_point_cloud_local_ = nh_.advertise<sensor_msgs::PointCloud2>("/pedsim/obstacle_cloud_local", 1);
+        // publisher for dynamic obstacles (people) as point clouds
+        pub_people_cloud_global_ = nh_.advertise<sensor_msgs::PointCloud2>("/pedsim/people_cloud_global", 1);
+        pub_people_cloud_local_ = nh_.advertise<sensor_msgs::PointCloud2>("/pedsim/people_cloud_local", 1);
+
+        // setup TF listener for obtaining robot position
+        transform_listener_ = boost::make_shared<tf::TransformListener>();
+
+        robot_position_.clear();
+        robot_position_.resize(2);
+        robot_position_ = { 0, 0 };
+
+        robot_frame_ = "odom";
+
+        // read local map dimensions
+        nh_.param("/pedsim_point_clouds/local_width", local_width_, 3.0);
+        nh_.param("/pedsim_point_clouds/local_height", local_height_, 3.0);
+    }
+    virtual ~PedsimCloud()
+    {
+        sub_grid_cells_.shutdown();
+        pub_point_cloud_global_.shutdown();
+        pub_point_cloud_local_.shutdown();
+        pub_people_cloud_global_.shutdown();
+        pub_people_cloud_local_.shutdown();
+    }
+
+    // subscriber callbacks
+    void callbackGridCells(const nav_msgs::GridCells::ConstPtr& msg);
+    void callbackTrackedPersons(const pedsim_msgs::TrackedPersons::ConstPtr& msg);
+    void callbackAgentStatesPacked(const pedsim_msgs::AgentStatesPacked::ConstPtr& msg);
+    void callbackRobotOdom(const nav_msgs::Odometry::ConstPtr& msg);
+
+private:
+    ros::NodeHandle nh_;
+
+    // robot position
+    std::vector<double> robot_position_;
+
+    // local zone around robot (used in local costmaps)
+    double local_width_;
+    double local_height_;
+    std::string robot_frame_;
+
+    // obstacle cells and the points sampled for them once
+    // (x, y, z, intensity per point, a fixed number of points per cell)
+    std::string obstacle_frame_;
+    PointGrid obstacle_index_;
+    std::vector<float> obstacle_points_;
+
+    // reused buffers for the local clouds
+    PointGrid people_index_;
+    std::vector<size_t> local_indices_;
+    std::vector<float> local_points_;
+
+    // publishers
+    ros::Publisher pub_point_cloud_global_;
+    ros::Publisher pub_point_cloud_local_;
+    ros::Publisher pub_people_cloud_global_;
+    ros::Publisher pub_people_cloud_local_;
+
+    // subscribers
+    ros::Subscriber sub_grid_cells_;
+    ros::Subscriber sub_tracked_persons_;
+    ros::Subscriber sub_robot_odom_;
+
+    // Transform listener coverting people poses to be relative to the robot
+    boost::shared_ptr<tf::TransformListener> transform_listener_;
+
+protected:
+    // indices of the indexed points in the local zone of the robot
+    void queryLocalZone(const PointGrid& index, std::vector<size_t>& indices);
+
+    // transform from the given frame into the robot frame
+    bool lookupRobotTransform(const std::string& frame_id, tf::StampedTransform& transform);
+
+    // cut out and publish the obstacle points around the robot
+    void publishLocalObstacles();
+
+    // publish global and local clouds of people at the given positions
+    void publishPeopleClouds(const std::string& frame_id, const std::vector<std::array<double, 2> >& people);
+
+    // append points (x, y, z, intensity) moved by a planar rigid transform
+    static void appendTransformed(const float* points, size_t num_points,
+        const tf::Transform& transform, std::vector<float>& out);
+
+    // fill a cloud with x, y, z, intensity float fields from packed points
+    static void fillCloud(const std::vector<float>& points, const std::string& frame_id,
+        sensor_msgs::PointCloud2& cloud);
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Social Robotics Laboratory
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \author Billy Okal <okal@cs.uni-freiburg.de>
+ */
+
+#ifndef POINT_GRID_H
+#define POINT_GRID_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// -----------------------------------------------------------
+/// \class PointGrid
+/// \brief Uniform bucket grid over 2D points for rectangle
+/// queries. Only the buckets overlapping the rectangle are
+/// visited, so a query costs in the size of the region and
+/// not in the number of points
+/// -----------------------------------------------------------
+class PointGrid {
+public:
+    explicit PointGrid(double bucket_size = 2.0)
+        : bucket_size_(bucket_size)
+    {
+    }
+
+    /// index the points, previous contents are dropped
+    void build(const std::vector<std::array<double, 2> >& points)
+    {
+        points_ = points;
+        buckets_.clear();
+        for (size_t i = 0; i < points_.size(); i++)
+            buckets_[key(cell(points_[i][0]), cell(points_[i][1]))].push_back(i);
+    }
+
+    /// indices of the points within [min_x, max_x] x [min_y, max_y]
+    void query(double min_x, double min_y, double max_x, double max_y, std::vector<size_t>& indices) const
+    {
+        indices.clear();
+        if (buckets_.empty())
+            return;
+
+        for (int64_t ix = cell(min_x); ix <= cell(max_x); ix++) {
+            for (int64_t iy = cell(min_y); iy <= cell(max_y); iy++) {
+                auto bucket = buckets_.find(key(ix, iy));
+                if (bucket == buckets_.end())
+                    continue;
+
+                for (const size_t i : bucket->second) {
+                    const std::array<double, 2>& p = points_[i];
+                    if (p[0] >= min_x && p[0] <= max_x && p[1] >= min_y && p[1] <= max_y)
+                        indices.push_back(i);
+                }
+            }
+        }
+    }
+
+private:
+    int64_t cell(double v) const { return static_cast<int64_t>(std::floor(v / bucket_size_)); }
+    static uint64_t key(int64_t ix, int64_t iy)
+    {
+        return (static_cast<uint64_t>(ix) << 32) ^ static_cast<uint32_t>(iy);
+    }
+
+    double bucket_size_;
+    std::vector<std::array<double, 2> > points_;
+    std::unordered_map<uint64_t, std::vector<size_t> > buckets_;
+};
+
+#endif
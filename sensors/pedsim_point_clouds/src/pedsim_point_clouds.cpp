@@ -34,250 +34,209 @@
  * \author Billy Okal <okal@cs.uni-freiburg.de>
  */
 
-#include <tf/transform_listener.h> // must come first due to conflict with Boost signals
+#include <pedsim_point_clouds/pedsim_point_clouds.h>
 
-/// ros
-#include <ros/ros.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
 
-/// meta
-#include <random>
-#include <cstdlib>
-#include <cmath>
+#include <cstring>
 
-/// data
-#include <sensor_msgs/PointCloud.h>
-#include <nav_msgs/GridCells.h>
-#include <nav_msgs/Odometry.h>
-#include <geometry_msgs/Point.h>
-#include <geometry_msgs/PoseStamped.h>
-#include <spencer_tracking_msgs/TrackedPerson.h>
-#include <spencer_tracking_msgs/TrackedPersons.h>
+namespace {
+// points sampled per obstacle cell and per person
+const unsigned int OBSTACLE_MPLEX = 200;
+const unsigned int PERSON_MPLEX = 100;
+}
 
 /// -----------------------------------------------------------
-/// \class PedsimCloud
-/// \brief Receives data from pedsim containing obstacles and
-/// persons and published it as point clouds
+/// \function queryLocalZone
+/// \brief Find the points (e.g. centers of persons or obstacles)
+/// within the local zone of the robot to be included in the
+/// robot's local costmap for planning and other higher level
+/// cognition. The zone is the local_width x local_height
+/// rectangle centered at the robot
 /// -----------------------------------------------------------
-class PedsimCloud {
-public:
-    PedsimCloud(const ros::NodeHandle& node)
-        : nh_(node)
-    {
-        // set up subscribers
-        sub_grid_cells_ = nh_.subscribe("/pedsim/static_obstacles", 1, &PedsimCloud::callbackGridCells, this);
-        sub_tracked_persons_ = nh_.subscribe("/pedsim/tracked_persons", 1, &PedsimCloud::callbackTrackedPersons, this);
-        sub_robot_odom_ = nh_.subscribe("/pedsim/robot_position", 1, &PedsimCloud::callbackRobotOdom, this);
-
-        // set up publishers
-        // publisher for static obstacles as point clouds
-        pub_point_cloud_global_ = nh_.advertise<sensor_msgs::PointCloud>("/pedsim/obstacle_cloud_global", 1);
-        pub_point_cloud_local_ = nh_.advertise<sensor_msgs::PointCloud>("/pedsim/obstacle_cloud_local", 1);
-        // publisher for dynamic obstacles (people) as point clouds
-        pub_people_cloud_global_ = nh_.advertise<sensor_msgs::PointCloud>("/pedsim/people_cloud_global", 1);
-        pub_people_cloud_local_ = nh_.advertise<sensor_msgs::PointCloud>("/pedsim/people_cloud_local", 1);
-
-        // setup TF listener for obtaining robot position
-        transform_listener_ = boost::make_shared<tf::TransformListener>();
-
-        robot_position_.clear();
-        robot_position_.resize(2);
-        robot_position_ = { 0, 0 };
-
-        robot_frame_ = "odom";
-
-        // read local map dimensions
-        nh_.param("/pedsim_point_clouds/local_width", local_width_, 3.0);
-        nh_.param("/pedsim_point_clouds/local_height", local_height_, 3.0);
-    }
-    virtual ~PedsimCloud()
-    {
-        sub_grid_cells_.shutdown();
-        pub_point_cloud_global_.shutdown();
-        pub_point_cloud_local_.shutdown();
-        pub_people_cloud_global_.shutdown();
-        pub_people_cloud_local_.shutdown();
-    }
-
-    // control
-    void run();
-
-    // subscriber callbacks
-    void callbackGridCells(const nav_msgs::GridCells::ConstPtr& msg);
-    void callbackTrackedPersons(const spencer_tracking_msgs::TrackedPersons::ConstPtr& msg);
-    void callbackRobotOdom(const nav_msgs::Odometry::ConstPtr& msg);
-
-private:
-    ros::NodeHandle nh_;
-
-    // robot position
-    std::vector<double> robot_position_;
-
-    // local zone around robot (used in local costmaps)
-    double local_width_;
-    double local_height_;
-    std::string robot_frame_;
-
-    // publishers
-    ros::Publisher pub_point_cloud_global_;
-    ros::Publisher pub_point_cloud_local_;
-    ros::Publisher pub_people_cloud_global_;
-    ros::Publisher pub_people_cloud_local_;
-
-    // subscribers
-    ros::Subscriber sub_grid_cells_;
-    ros::Subscriber sub_tracked_persons_;
-    ros::Subscriber sub_robot_odom_;
+void PedsimCloud::queryLocalZone(const PointGrid& index, std::vector<size_t>& indices)
+{
+    const double half_width = local_width_ / 2.0;
+    const double half_height = local_height_ / 2.0;
 
-    // Transform listener coverting people poses to be relative to the robot
-    boost::shared_ptr<tf::TransformListener> transform_listener_;
+    index.query(robot_position_[0] - half_width, robot_position_[1] - half_height,
+        robot_position_[0] + half_width, robot_position_[1] + half_height, indices);
+}
 
-protected:
-    // check if a point is in the local zone of the robot
-    bool inLocalZone(const std::array<double, 2>& point);
-};
+/// -----------------------------------------------------------
+/// \function lookupRobotTransform
+/// \brief Transform from a message frame into the robot frame
+/// -----------------------------------------------------------
+bool PedsimCloud::lookupRobotTransform(const std::string& frame_id, tf::StampedTransform& transform)
+{
+    try {
+        transform_listener_->lookupTransform(robot_frame_, frame_id, ros::Time(0), transform);
+    }
+    catch (tf::TransformException& e) {
+        ROS_WARN_STREAM_THROTTLE(5.0, "TF lookup from " << frame_id << " to " << robot_frame_ << " failed. Reason: " << e.what());
+        return false;
+    }
+    return true;
+}
 
 /// -----------------------------------------------------------
-/// \function run
-/// \brief Run the node
+/// \function appendTransformed
+/// \brief Rotate about z and translate a block of points, the
+/// single transform is applied with plain arithmetic per point
 /// -----------------------------------------------------------
-void PedsimCloud::run()
+void PedsimCloud::appendTransformed(const float* points, size_t num_points,
+    const tf::Transform& transform, std::vector<float>& out)
 {
-    ros::Rate r(30); // Hz
-    while (ros::ok()) {
-        ros::spinOnce();
-        r.sleep();
+    const float yaw = tf::getYaw(transform.getRotation());
+    const float c = std::cos(yaw);
+    const float s = std::sin(yaw);
+    const float tx = transform.getOrigin().x();
+    const float ty = transform.getOrigin().y();
+
+    const size_t offset = out.size();
+    out.resize(offset + 4 * num_points);
+    float* target = &out[offset];
+
+    for (size_t i = 0; i < num_points; i++) {
+        const float* p = points + 4 * i;
+        float* q = target + 4 * i;
+        q[0] = c * p[0] - s * p[1] + tx;
+        q[1] = s * p[0] + c * p[1] + ty;
+        q[2] = p[2];
+        q[3] = p[3];
     }
 }
 
 /// -----------------------------------------------------------
-/// \function inLocalZone
-/// \brief Check is a point (e.g. center of person or obstacle)
-/// is within the local zone of the robot to be included in the
-/// robot's local costmap for planning and other higher level
-/// cognition
+/// \function fillCloud
+/// \brief Copy packed x, y, z, intensity floats into a cloud
 /// -----------------------------------------------------------
-bool PedsimCloud::inLocalZone(const std::array<double, 2>& point)
+void PedsimCloud::fillCloud(const std::vector<float>& points, const std::string& frame_id,
+    sensor_msgs::PointCloud2& cloud)
 {
-    // NOTE - this hack expands the local map, but that should not cause any
-    // issue since we are mainly interested in not missing anythin in the
-    // local region
-    const double r = std::max(local_width_, local_height_);
-    const double dist = std::hypot(robot_position_[0] - point[0], robot_position_[1] - point[1]);
-
-    if (dist <= r)
-        return true;
-    else
-        return false;
+    cloud.header.stamp = ros::Time::now();
+    cloud.header.frame_id = frame_id;
+
+    sensor_msgs::PointCloud2Modifier modifier(cloud);
+    modifier.setPointCloud2Fields(4,
+        "x", 1, sensor_msgs::PointField::FLOAT32,
+        "y", 1, sensor_msgs::PointField::FLOAT32,
+        "z", 1, sensor_msgs::PointField::FLOAT32,
+        "intensity", 1, sensor_msgs::PointField::FLOAT32);
+    modifier.resize(points.size() / 4);
+
+    // the fields are contiguous floats, same layout as the points
+    if (!points.empty())
+        std::memcpy(&cloud.data[0], points.data(), points.size() * sizeof(float));
 }
 
 /// -----------------------------------------------------------
 /// \function callbackGridCells
-/// \brief Receives grid cells fro pedsim to convert into pcs
+/// \brief Receives grid cells fro pedsim to convert into pcs.
+/// The obstacles are static (latched topic), so the points are
+/// sampled once here and the global cloud is published latched
 /// -----------------------------------------------------------
 void PedsimCloud::callbackGridCells(const nav_msgs::GridCells::ConstPtr& msg)
 {
-    const unsigned int mplex = 200;
-    int num_points = msg->cells.size() * mplex;
-
-    // global cloud
-    sensor_msgs::PointCloud cloud_global;
-    cloud_global.header.stamp = ros::Time::now();
-    cloud_global.header.frame_id = "odom";
-    cloud_global.points.resize(num_points);
-    cloud_global.channels.resize(1);
-    cloud_global.channels[0].name = "intensities";
-    cloud_global.channels[0].values.resize(num_points);
-
-    // local obstacle cloud
-    sensor_msgs::PointCloud cloud_local;
-    cloud_local.header.stamp = ros::Time::now();
-    cloud_local.header.frame_id = robot_frame_;
-    cloud_local.points.resize(num_points);
-    cloud_local.channels.resize(1);
-    cloud_local.channels[0].name = "intensities";
-    cloud_local.channels[0].values.resize(num_points);
-
     // processing
     std::default_random_engine generator;
     std::uniform_real_distribution<float> float_dist(0, 2);
     std::uniform_real_distribution<float> wide_dist(0, 1);
 
-    // Get the positions of people relative to the robot via TF transform
-    tf::StampedTransform tfTransform;
-    try {
-        transform_listener_->lookupTransform(robot_frame_, msg->header.frame_id, ros::Time(0), tfTransform);
-    }
-    catch (tf::TransformException& e) {
-        ROS_WARN_STREAM_THROTTLE(5.0, "TF lookup from base_footprint to odom failed. Reason: " << e.what());
-        return;
-    }
+    obstacle_frame_ = msg->header.frame_id;
+    obstacle_points_.clear();
+    obstacle_points_.reserve(4 * OBSTACLE_MPLEX * msg->cells.size());
+
+    std::vector<std::array<double, 2> > cells;
+    cells.reserve(msg->cells.size());
 
-    int index = 0;
-    for (unsigned int i = 0; i < msg->cells.size(); i++) {
-        geometry_msgs::Point cell = msg->cells[i];
-        std::array<double, 2> obstacle = { cell.x, cell.y };
-        const bool inside = inLocalZone(obstacle);
-
-        for (unsigned int j = 0; j < mplex; j++) {
-            // positions relative the robot (local)
-            if (inside) {
-                tf::Pose source;
-                source.setOrigin(tf::Vector3(cell.x + wide_dist(generator), cell.y + wide_dist(generator), 0));
-                tf::Matrix3x3 identity;
-                identity.setIdentity();
-                source.setBasis(identity);
-                /// Apply the proper transform
-                tf::Pose result = tfTransform * source;
-
-                cloud_local.points[index].x = result.getOrigin().x();
-                cloud_local.points[index].y = result.getOrigin().y();
-                cloud_local.points[index].z = cell.z + float_dist(generator); // random points in a line
-                cloud_local.channels[0].values[index] = 80;
-            }
-
-            // global positions
-            cloud_global.points[index].x = cell.x + wide_dist(generator);
-            cloud_global.points[index].y = cell.y + wide_dist(generator);
-            cloud_global.points[index].z = cell.z + float_dist(generator); // random points in a line
-            cloud_global.channels[0].values[index] = 50;
-
-            index++;
+    for (const geometry_msgs::Point& cell : msg->cells) {
+        cells.push_back({ cell.x, cell.y });
+
+        for (unsigned int j = 0; j < OBSTACLE_MPLEX; j++) {
+            obstacle_points_.push_back(cell.x + wide_dist(generator));
+            obstacle_points_.push_back(cell.y + wide_dist(generator));
+            obstacle_points_.push_back(cell.z + float_dist(generator)); // random points in a line
+            obstacle_points_.push_back(50);
         }
     }
 
-    // avoid publishing empty local clouds
-    if (cloud_local.channels[0].values.size() > 1)
-        pub_point_cloud_local_.publish(cloud_local);
+    // the cells do not move, index them once
+    obstacle_index_.build(cells);
 
+    sensor_msgs::PointCloud2Ptr cloud_global(new sensor_msgs::PointCloud2);
+    fillCloud(obstacle_points_, "odom", *cloud_global);
     pub_point_cloud_global_.publish(cloud_global);
+
+    publishLocalObstacles();
+}
+
+/// -----------------------------------------------------------
+/// \function publishLocalObstacles
+/// \brief Publish the obstacle points close to the robot, in the
+/// robot frame
+/// -----------------------------------------------------------
+void PedsimCloud::publishLocalObstacles()
+{
+    if (obstacle_points_.empty())
+        return;
+
+    tf::StampedTransform tfTransform;
+    if (!lookupRobotTransform(obstacle_frame_, tfTransform))
+        return;
+
+    queryLocalZone(obstacle_index_, local_indices_);
+
+    local_points_.clear();
+    for (const size_t i : local_indices_)
+        appendTransformed(&obstacle_points_[4 * OBSTACLE_MPLEX * i], OBSTACLE_MPLEX, tfTransform, local_points_);
+
+    // avoid publishing empty local clouds
+    if (local_points_.empty())
+        return;
+
+    sensor_msgs::PointCloud2Ptr cloud_local(new sensor_msgs::PointCloud2);
+    fillCloud(local_points_, robot_frame_, *cloud_local);
+    pub_point_cloud_local_.publish(cloud_local);
 }
 
 /// -----------------------------------------------------------
 /// \function callbackTrackedPersons
 /// \brief Receives tracked persons messages and saves them
 /// -----------------------------------------------------------
-void PedsimCloud::callbackTrackedPersons(const spencer_tracking_msgs::TrackedPersons::ConstPtr& msg)
+void PedsimCloud::callbackTrackedPersons(const pedsim_msgs::TrackedPersons::ConstPtr& msg)
+{
+    std::vector<std::array<double, 2> > people;
+    people.reserve(msg->tracks.size());
+    for (const auto& p : msg->tracks)
+        people.push_back({ p.pose.pose.position.x, p.pose.pose.position.y });
+
+    publishPeopleClouds(msg->header.frame_id, people);
+}
+
+/// -----------------------------------------------------------
+/// \function callbackAgentStatesPacked
+/// \brief Receives the compact agent states (robots are skipped)
+/// -----------------------------------------------------------
+void PedsimCloud::callbackAgentStatesPacked(const pedsim_msgs::AgentStatesPacked::ConstPtr& msg)
+{
+    std::vector<std::array<double, 2> > people;
+    people.reserve(msg->ids.size());
+    for (size_t i = 0; i < msg->ids.size(); i++) {
+        if (msg->type[i] == pedsim_msgs::AgentStatesPacked::TYPE_ROBOT)
+            continue;
+        people.push_back({ msg->x[i], msg->y[i] });
+    }
+
+    publishPeopleClouds(msg->header.frame_id, people);
+}
+
+/// -----------------------------------------------------------
+/// \function publishPeopleClouds
+/// \brief Sample points around each person and publish them
+/// -----------------------------------------------------------
+void PedsimCloud::publishPeopleClouds(const std::string& frame_id, const std::vector<std::array<double, 2> >& people)
 {
-    const unsigned int mplex = 100;
-    int num_points = msg->tracks.size() * mplex;
-
-    // global cloud
-    sensor_msgs::PointCloud cloud_global;
-    cloud_global.header.stamp = ros::Time::now();
-    cloud_global.header.frame_id = "odom";
-    cloud_global.points.resize(num_points);
-    cloud_global.channels.resize(1);
-    cloud_global.channels[0].name = "intensities";
-    cloud_global.channels[0].values.resize(num_points);
-
-    // local obstacle cloud
-    sensor_msgs::PointCloud cloud_local;
-    cloud_local.header.stamp = ros::Time::now();
-    cloud_local.header.frame_id = robot_frame_;
-    cloud_local.points.resize(num_points);
-    cloud_local.channels.resize(1);
-    cloud_local.channels[0].name = "intensities";
-    cloud_local.channels[0].values.resize(num_points);
     // make some random intensities for the persons
     std::default_random_engine generator;
     std::uniform_int_distribution<int> int_dist(10, 255);
@@ -286,59 +245,45 @@ void PedsimCloud::callbackTrackedPersons(const spencer_tracking_msgs::TrackedPer
 
     // Get the positions of people relative to the robot via TF transform
     tf::StampedTransform tfTransform;
-    try {
-        transform_listener_->lookupTransform(robot_frame_, msg->header.frame_id, ros::Time(0), tfTransform);
-    }
-    catch (tf::TransformException& e) {
-        ROS_WARN_STREAM_THROTTLE(5.0, "TFP lookup from base_footprint to odom failed. Reason: " << e.what());
+    if (!lookupRobotTransform(frame_id, tfTransform))
         return;
-    }
 
-    int index = 0;
-    for (unsigned int i = 0; i < msg->tracks.size(); i++) {
-        spencer_tracking_msgs::TrackedPerson p = msg->tracks[i];
-        std::array<double, 2> person = { p.pose.pose.position.x, p.pose.pose.position.y };
-        const bool inside = inLocalZone(person);
-
-        for (unsigned int j = 0; j < mplex; j++) {
-            // positions relative the robot (local)
-            if (inside) {
-                tf::Pose source;
-                source.setOrigin(tf::Vector3(p.pose.pose.position.x + wide_dist(generator),
-                    p.pose.pose.position.y + wide_dist(generator),
-                    0));
-                tf::Matrix3x3 identity;
-                identity.setIdentity();
-                source.setBasis(identity);
-                /// Apply the proper transform
-                tf::Pose result = tfTransform * source;
-
-                cloud_local.points[index].x = result.getOrigin().x();
-                cloud_local.points[index].y = result.getOrigin().y();
-                cloud_local.points[index].z = float_dist(generator); // random points in a line
-                cloud_local.channels[0].values[index] = int_dist(generator);
-            }
-
-            // global
-            cloud_global.points[index].x = p.pose.pose.position.x + wide_dist(generator);
-            cloud_global.points[index].y = p.pose.pose.position.y + wide_dist(generator);
-            cloud_global.points[index].z = float_dist(generator); // random points in a line
-            cloud_global.channels[0].values[index] = int_dist(generator);
-
-            index++;
+    // global
+    std::vector<float> points;
+    points.reserve(4 * PERSON_MPLEX * people.size());
+    for (const auto& person : people) {
+        for (unsigned int j = 0; j < PERSON_MPLEX; j++) {
+            points.push_back(person[0] + wide_dist(generator));
+            points.push_back(person[1] + wide_dist(generator));
+            points.push_back(float_dist(generator)); // random points in a line
+            points.push_back(int_dist(generator));
         }
     }
 
+    // positions relative the robot (local)
+    people_index_.build(people);
+    queryLocalZone(people_index_, local_indices_);
+
+    local_points_.clear();
+    for (const size_t i : local_indices_)
+        appendTransformed(&points[4 * PERSON_MPLEX * i], PERSON_MPLEX, tfTransform, local_points_);
+
     // avoid publishing empty local clouds
-    if (cloud_local.channels[0].values.size() > 1)
+    if (!local_points_.empty()) {
+        sensor_msgs::PointCloud2Ptr cloud_local(new sensor_msgs::PointCloud2);
+        fillCloud(local_points_, robot_frame_, *cloud_local);
         pub_people_cloud_local_.publish(cloud_local);
+    }
 
+    sensor_msgs::PointCloud2Ptr cloud_global(new sensor_msgs::PointCloud2);
+    fillCloud(points, "odom", *cloud_global);
     pub_people_cloud_global_.publish(cloud_global);
 }
 
 /// -----------------------------------------------------------
 /// \function callbackRobotOdom
-/// \brief Receives robot position and cache it for use later
+/// \brief Receives robot position and cache it for use later,
+/// the local obstacle cloud follows the robot
 /// -----------------------------------------------------------
 void PedsimCloud::callbackRobotOdom(const nav_msgs::Odometry::ConstPtr& msg)
 {
@@ -346,19 +291,6 @@ void PedsimCloud::callbackRobotOdom(const nav_msgs::Odometry::ConstPtr& msg)
     robot_position_[1] = msg->pose.pose.position.y;
 
     robot_frame_ = msg->header.frame_id;
-}
-
-/// -----------------------------------------------------------
-/// main
-/// -----------------------------------------------------------
-int main(int argc, char** argv)
-{
-    ros::init(argc, argv, "pedsim_point_clouds");
-
-    ros::NodeHandle n;
-
-    PedsimCloud g(n);
-    g.run();
 
-    return EXIT_SUCCESS;
+    publishLocalObstacles();
 }
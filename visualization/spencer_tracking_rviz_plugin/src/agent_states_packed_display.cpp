@@ -0,0 +1,283 @@
+#include <rviz/visualization_manager.h>
+#include <rviz/frame_manager.h>
+#include "rviz/selection/selection_manager.h"
+
+#include "agent_states_packed_display.h"
+
+#include <boost/foreach.hpp>
+#define foreach BOOST_FOREACH
+
+
+namespace spencer_tracking_rviz_plugin
+{
+
+// The constructor must have no arguments, so we can't give the
+// constructor the parameters it needs to fully initialize.
+void AgentStatesPackedDisplay::onInitialize()
+{
+    PersonDisplayCommon::onInitialize();
+
+    QObject::connect(m_commonProperties->style, SIGNAL(changed()), this, SLOT(personVisualTypeChanged()) );
+
+    m_render_person_property            = new rviz::BoolProperty( "Render person visual", true, "Render person visualization", this, SLOT(stylesChanged()));
+    m_render_velocities_property        = new rviz::BoolProperty( "Render velocities", true, "Render agent velocity arrows", this, SLOT(stylesChanged()));
+    m_render_ids_property               = new rviz::BoolProperty( "Render agent IDs", false, "Render agent IDs as text", this, SLOT(stylesChanged()));
+    m_render_agent_state_property       = new rviz::BoolProperty( "Render agent state", false, "Render agent state text", this, SLOT(stylesChanged()));
+    m_show_robot_property               = new rviz::BoolProperty( "Show robot", false, "Show the robot agent, which is usually visualized separately", this, SLOT(stylesChanged()));
+}
+
+AgentStatesPackedDisplay::~AgentStatesPackedDisplay()
+{
+    m_cachedAgents.clear();
+}
+
+// Clear the visuals by deleting their objects.
+void AgentStatesPackedDisplay::reset()
+{
+    PersonDisplayCommon::reset();
+    m_cachedAgents.clear();
+}
+
+void AgentStatesPackedDisplay::update(float wall_dt, float ros_dt)
+{
+    // Update animation etc.
+    foreach(const agent_map::value_type& entry, m_cachedAgents)
+    {
+        const shared_ptr<PackedAgentVisual>& agentVisual = entry.second;
+        if(agentVisual->personVisual) agentVisual->personVisual->update(ros_dt);
+    }
+}
+
+const char* AgentStatesPackedDisplay::getStateName(unsigned char state)
+{
+    switch(state) {
+        case pedsim_msgs::AgentStatesPacked::STATE_WAITING: return "WAITING";
+        case pedsim_msgs::AgentStatesPacked::STATE_WAITING_IN_QUEUE: return "QUEUEING";
+        case pedsim_msgs::AgentStatesPacked::STATE_INDIVIDUAL_MOVING: return "WALKING";
+        case pedsim_msgs::AgentStatesPacked::STATE_GROUP_MOVING: return "GROUP WALKING";
+        case pedsim_msgs::AgentStatesPacked::STATE_SHOPPING: return "SHOPPING";
+        default: return "";
+    }
+}
+
+/// Update all dynamically adjusted visualization properties (colors, font sizes etc.) of all agents
+void AgentStatesPackedDisplay::stylesChanged()
+{
+    foreach(const agent_map::value_type& entry, m_cachedAgents)
+    {
+        const agent_id agentId = entry.first;
+        const shared_ptr<PackedAgentVisual>& agentVisual = entry.second;
+
+        // Update common styles to person visual, such as line width
+        applyCommonStyles(agentVisual->personVisual);
+
+        // Update agent visibility
+        bool agentVisible = !isPersonHidden(agentId);
+        if(agentVisual->type == pedsim_msgs::AgentStatesPacked::TYPE_ROBOT) agentVisible &= m_show_robot_property->getBool();
+        agentVisual->sceneNode->setVisible(agentVisible);
+
+        // Get current agent color
+        Ogre::ColourValue agentColor = getColorFromId(agentId);
+        agentColor.a *= m_commonProperties->alpha->getFloat(); // general alpha
+
+        // Update person color
+        Ogre::ColourValue personColor = agentColor;
+        if(!m_render_person_property->getBool()) personColor.a = 0.0;
+
+        if(agentVisual->personVisual) {
+            agentVisual->personVisual->setColor(personColor);
+        }
+
+        // Update text colors, font size and visibility
+        const double personHeight = agentVisual->personVisual ? agentVisual->personVisual->getHeight() : 0;
+        Ogre::ColourValue fontColor = m_commonProperties->font_color_style->getOptionInt() == FONT_COLOR_CONSTANT ? m_commonProperties->constant_font_color->getOgreColor() : agentColor;
+        fontColor.a = m_commonProperties->alpha->getFloat();
+
+        agentVisual->stateText->setCharacterHeight(0.18 * m_commonProperties->font_scale->getFloat());
+        agentVisual->stateText->setVisible(m_render_agent_state_property->getBool() && agentVisible);
+        agentVisual->stateText->setColor(fontColor);
+        agentVisual->stateText->setPosition(Ogre::Vector3(0,0, personHeight + agentVisual->stateText->getCharacterHeight()));
+
+        const double stateTextOffset = m_render_agent_state_property->getBool() ? 1.2*agentVisual->stateText->getCharacterHeight() : 0;
+        agentVisual->idText->setCharacterHeight(0.25 * m_commonProperties->font_scale->getFloat());
+        agentVisual->idText->setVisible(m_render_ids_property->getBool() && agentVisible);
+        agentVisual->idText->setColor(fontColor);
+        agentVisual->idText->setPosition(Ogre::Vector3(0,0, personHeight + agentVisual->idText->getCharacterHeight() + stateTextOffset));
+
+        // Update velocity arrow color
+        double arrowAlpha = m_render_velocities_property->getBool() ? agentColor.a : 0.0;
+        if(agentVisual->hasZeroVelocity) arrowAlpha = 0.0;
+        agentVisual->velocityArrow->setColor(Ogre::ColourValue(agentColor.r, agentColor.g, agentColor.b, arrowAlpha));
+    }
+}
+
+// Set the rendering style (cylinders, meshes, ...) of agents
+void AgentStatesPackedDisplay::personVisualTypeChanged()
+{
+    foreach(const agent_map::value_type& entry, m_cachedAgents)
+    {
+        const shared_ptr<PackedAgentVisual>& agentVisual = entry.second;
+        agentVisual->personVisual.reset();
+        createPersonVisualIfRequired(agentVisual->sceneNode.get(), agentVisual->personVisual);
+    }
+    stylesChanged();
+}
+
+// This is our callback to handle an incoming message.
+void AgentStatesPackedDisplay::processMessage(const pedsim_msgs::AgentStatesPacked::ConstPtr& msg)
+{
+    // All arrays are indexed by agent, so they must have the same length
+    const size_t numAgents = msg->ids.size();
+    if(msg->x.size() != numAgents || msg->y.size() != numAgents || msg->vx.size() != numAgents || msg->vy.size() != numAgents
+        || msg->type.size() != numAgents || msg->state.size() != numAgents)
+    {
+        setStatusStd(rviz::StatusProperty::Error, "Agents", "Arrays of AgentStatesPacked message have different lengths");
+        return;
+    }
+
+    // Get transforms into fixed frame etc.
+    if(!preprocessMessage(msg)) return;
+
+    Ogre::Matrix4 transform(m_frameOrientation);
+    transform.setTrans(m_framePosition);
+
+    stringstream ss;
+
+    //
+    // Iterate over all agents in this message, see if we have a cached visual (then update it) or create a new one.
+    //
+    set<agent_id> encounteredAgentIds;
+    for (size_t i = 0; i < numAgents; i++)
+    {
+        const agent_id agentId = msg->ids[i];
+        shared_ptr<PackedAgentVisual> agentVisual;
+
+        // See if we encountered this agent ID before in this loop (means duplicate agent ID)
+        if (!encounteredAgentIds.insert(agentId).second) {
+            ROS_ERROR_STREAM("pedsim_msgs::AgentStatesPacked contains duplicate agent ID " << agentId << "! Skipping duplicate agent.");
+            continue;
+        }
+
+        const Ogre::Vector3 originalPosition(msg->x[i], msg->y[i], 0);
+        const Ogre::Vector3 velocityVector(msg->vx[i], msg->vy[i], 0);
+
+        if(originalPosition.isNaN() || velocityVector.isNaN()) {
+            ROS_WARN_THROTTLE(5.0, "Agent %u has non-finite position or velocity! Something is wrong!", agentId);
+            continue;
+        }
+
+        // See if we have cached an agent with this ID
+        agent_map::iterator cachedAgentIt = m_cachedAgents.find(agentId);
+        if (cachedAgentIt != m_cachedAgents.end()) {
+            agentVisual = cachedAgentIt->second;
+        }
+        else {
+            // Create a new visual representation of the agent
+            agentVisual = shared_ptr<PackedAgentVisual>(new PackedAgentVisual);
+            m_cachedAgents[agentId] = agentVisual;
+
+            // This scene node is the parent of all visualization elements for the agent
+            agentVisual->sceneNode = shared_ptr<Ogre::SceneNode>(scene_node_->createChildSceneNode());
+            agentVisual->hasZeroVelocity = true;
+        }
+
+        agentVisual->type = msg->type[i];
+        Ogre::SceneNode* currentSceneNode = agentVisual->sceneNode.get();
+
+
+        //
+        // Person visualization
+        //
+
+        // Create new visual for the person itself, if needed
+        shared_ptr<PersonVisual> &personVisual = agentVisual->personVisual;
+        createPersonVisualIfRequired(currentSceneNode, personVisual);
+
+        const double personHeight = personVisual ? personVisual->getHeight() : 0;
+        const double halfPersonHeight = personHeight / 2.0;
+
+
+        //
+        // Position and orientation of entire agent
+        //
+
+        Ogre::Vector3 positionInTargetFrame = transform * originalPosition;
+        positionInTargetFrame.z = m_commonProperties->z_offset->getFloat(); // the packed message has no z coordinate
+        currentSceneNode->setPosition(positionInTargetFrame);
+
+        // Agents face their walking direction; standing agents keep their last orientation
+        agentVisual->hasZeroVelocity = velocityVector.length() < 0.05;
+        if(!agentVisual->hasZeroVelocity) {
+            const Ogre::Quaternion walkingDirection(Ogre::Radian(atan2(velocityVector.y, velocityVector.x)), Ogre::Vector3::UNIT_Z);
+            currentSceneNode->setOrientation(m_frameOrientation * walkingDirection);
+        }
+
+
+        //
+        // Texts
+        //
+        {
+            if (!agentVisual->idText) {
+                agentVisual->idText.reset(new TextNode(context_->getSceneManager(), currentSceneNode));
+                agentVisual->stateText.reset(new TextNode(context_->getSceneManager(), currentSceneNode));
+            }
+
+            // Agent state
+            agentVisual->stateText->setCaption(getStateName(msg->state[i]));
+
+            // Agent ID
+            ss.str(""); ss << agentId;
+            agentVisual->idText->setCaption(ss.str());
+        }
+
+
+        //
+        // Velocity arrows
+        //
+        if (!agentVisual->velocityArrow) {
+            agentVisual->velocityArrow.reset(new rviz::Arrow(context_->getSceneManager(), currentSceneNode));
+        }
+
+        // Update velocity arrow, which points forward since the scene node is aligned with the velocity
+        {
+            const double personRadius = 0.2;
+            const Ogre::Vector3 velocityArrowAttachPoint(personRadius, 0, halfPersonHeight); // relative to agent's scene node
+            agentVisual->velocityArrow->setPosition(velocityArrowAttachPoint);
+            agentVisual->velocityArrow->setOrientation(Ogre::Vector3::NEGATIVE_UNIT_Z.getRotationTo(Ogre::Vector3::UNIT_X));
+
+            const double shaftLength = velocityVector.length(), shaftDiameter = 0.05, headLength = 0.2, headDiameter = 0.2;
+            agentVisual->velocityArrow->set(shaftLength, shaftDiameter, headLength, headDiameter);
+
+            shared_ptr<MeshPersonVisual> meshPersonVisual = boost::dynamic_pointer_cast<MeshPersonVisual>(personVisual);
+            if(meshPersonVisual) {
+                meshPersonVisual->setWalkingSpeed(velocityVector.length());
+            }
+        }
+
+    } // end for loop over all agents
+
+    //
+    // Delete agents which are not part of this message any more, the message always contains all agents
+    //
+    for (agent_map::iterator cachedAgentIt = m_cachedAgents.begin(); cachedAgentIt != m_cachedAgents.end(); ) {
+        if (encounteredAgentIds.end() == encounteredAgentIds.find(cachedAgentIt->first)) m_cachedAgents.erase(cachedAgentIt++);
+        else ++cachedAgentIt;
+    }
+
+    // Set all properties which can be dynamically in the GUI. This iterates over all agents.
+    stylesChanged();
+
+    //
+    // Update status (shown in property pane)
+    //
+    ss.str("");
+    ss << numAgents << " agents received";
+    setStatusStd(rviz::StatusProperty::Ok, "Agents", ss.str());
+}
+
+} // end namespace spencer_tracking_rviz_plugin
+
+// Tell pluginlib about this class.  It is important to do this in
+// global scope, outside our package's namespace.
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_EXPORT_CLASS(spencer_tracking_rviz_plugin::AgentStatesPackedDisplay, rviz::Display)
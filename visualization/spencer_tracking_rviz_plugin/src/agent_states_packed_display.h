@@ -0,0 +1,80 @@
+#ifndef AGENT_STATES_PACKED_DISPLAY_H
+#define AGENT_STATES_PACKED_DISPLAY_H
+
+#include <map>
+
+#include <pedsim_msgs/AgentStatesPacked.h>
+
+#include "person_display_common.h"
+
+namespace spencer_tracking_rviz_plugin
+{
+    typedef unsigned int agent_id;
+
+    /// The visual of a simulated agent.
+    struct PackedAgentVisual
+    {
+        shared_ptr<Ogre::SceneNode> sceneNode;
+
+        shared_ptr<PersonVisual> personVisual;
+        shared_ptr<TextNode> idText, stateText;
+        shared_ptr<rviz::Arrow> velocityArrow;
+
+        unsigned char type;
+        bool hasZeroVelocity;
+    };
+
+    // Displays the agents of a pedsim_msgs/AgentStatesPacked message. The packed message has
+    // no covariances, track states or histories, so this only renders persons, velocities and texts.
+    class AgentStatesPackedDisplay: public PersonDisplayCommon<pedsim_msgs::AgentStatesPacked>
+    {
+    Q_OBJECT
+    public:
+        // Constructor.  pluginlib::ClassLoader creates instances by calling
+        // the default constructor, so make sure you have one.
+        AgentStatesPackedDisplay() {};
+        virtual ~AgentStatesPackedDisplay();
+
+        // Called after the constructors have run
+        virtual void onInitialize();
+
+        // Called periodically by the visualization manager
+        virtual void update(float wall_dt, float ros_dt);
+
+    protected:
+        // A helper to clear this display back to the initial state.
+        virtual void reset();
+
+        // Must be implemented by derived classes because MOC doesn't work in templates
+        virtual rviz::DisplayContext* getContext() {
+            return context_;
+        }
+
+    private Q_SLOTS:
+        void personVisualTypeChanged();
+
+        // Called whenever one of the properties in PersonDisplayCommonProperties has been changed
+        virtual void stylesChanged();
+
+    private:
+        // Function to handle an incoming ROS message.
+        void processMessage(const pedsim_msgs::AgentStatesPacked::ConstPtr& msg);
+
+        // Human-readable name of an agent state constant
+        static const char* getStateName(unsigned char state);
+
+        // All agents of the last message, with agent ID as map key
+        typedef map<agent_id, shared_ptr<PackedAgentVisual> > agent_map;
+        agent_map m_cachedAgents;
+
+        // User-editable property variables.
+        rviz::BoolProperty* m_render_person_property;
+        rviz::BoolProperty* m_render_velocities_property;
+        rviz::BoolProperty* m_render_ids_property;
+        rviz::BoolProperty* m_render_agent_state_property;
+        rviz::BoolProperty* m_show_robot_property;
+    };
+
+} // end namespace spencer_tracking_rviz_plugin
+
+#endif // AGENT_STATES_PACKED_DISPLAY_H